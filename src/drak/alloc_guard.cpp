@@ -0,0 +1,73 @@
+#include "alloc_guard.hpp"
+
+#ifdef LLC_STATIC_ALLOC
+
+#include "esp_system.h"
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+static void *alloc_guard_malloc(std::size_t size)
+{
+    if (alloc_guard_armed.load(std::memory_order_acquire))
+        esp_system_abort("heap allocation after boot");
+
+    return std::malloc(size == 0 ? 1 : size);
+}
+
+static void *alloc_guard_aligned_malloc(std::size_t size, std::align_val_t align)
+{
+    if (alloc_guard_armed.load(std::memory_order_acquire))
+        esp_system_abort("heap allocation after boot");
+
+    // aligned_alloc wants a size that is a multiple of the alignment.
+    const std::size_t a = static_cast<std::size_t>(align);
+    return std::aligned_alloc(a, size == 0 ? a : (size + a - 1) / a * a);
+}
+
+static void *alloc_guard_new(std::size_t size)
+{
+    void *p = alloc_guard_malloc(size);
+
+    if (p == nullptr)
+        esp_system_abort("out of memory");
+
+    return p;
+}
+
+static void *alloc_guard_aligned_new(std::size_t size, std::align_val_t align)
+{
+    void *p = alloc_guard_aligned_malloc(size, align);
+
+    if (p == nullptr)
+        esp_system_abort("out of memory");
+
+    return p;
+}
+
+void *operator new(std::size_t size) { return alloc_guard_new(size); }
+void *operator new[](std::size_t size) { return alloc_guard_new(size); }
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept { return alloc_guard_malloc(size); }
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept { return alloc_guard_malloc(size); }
+
+void *operator new(std::size_t size, std::align_val_t align) { return alloc_guard_aligned_new(size, align); }
+void *operator new[](std::size_t size, std::align_val_t align) { return alloc_guard_aligned_new(size, align); }
+void *operator new(std::size_t size, std::align_val_t align, const std::nothrow_t &) noexcept
+{
+    return alloc_guard_aligned_malloc(size, align);
+}
+void *operator new[](std::size_t size, std::align_val_t align, const std::nothrow_t &) noexcept
+{
+    return alloc_guard_aligned_malloc(size, align);
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::size_t) noexcept { std::free(p); }
+void operator delete(void *p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+
+#endif // LLC_STATIC_ALLOC
@@ -0,0 +1,19 @@
+#ifndef ALLOC_GUARD_HPP
+#define ALLOC_GUARD_HPP
+
+#include <atomic>
+
+// Armed once boot has finished setting up tasks, sockets and servers. From
+// then on the receive and render paths must not touch the heap.
+inline std::atomic<bool> alloc_guard_armed{false};
+
+inline void alloc_guard_arm() { alloc_guard_armed.store(true, std::memory_order_release); }
+
+// With LLC_STATIC_ALLOC, alloc_guard.cpp replaces the global operator new
+// and delete, so any C++ allocation after arming aborts and the panic
+// backtrace points at the offender. The replacements must be defined in
+// exactly one translation unit, hence the separate file. ESP-IDF components
+// written in C (Wi-Fi, lwIP, the HTTP server) call malloc directly and are
+// not covered.
+
+#endif // ALLOC_GUARD_HPP
@@ -0,0 +1,526 @@
+#ifndef ANIM_HPP
+#define ANIM_HPP
+
+#include "bytes.hpp"
+#include "result.hpp"
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <cstddef>
+#include <vector>
+
+#ifdef ESP_PLATFORM
+#include "esp_partition.h"
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Flash-resident animation library.
+//
+// The partition is split into fixed slots, one animation per slot. A slot
+// holds a blob: AnimHeader followed by packed ops, optionally LZ-compressed.
+// Blobs are built by anim_encode() (usable on the host as well) and uploaded
+// in chunks; playback reads them in place from the memory-mapped partition.
+//
+// Blob header, little-endian:
+//   magic (4) | flags (1) | reserved (1) | op count (2) | data size (4) | reserved (4)
+// Packed op, little-endian:
+//   led index (2) | r (1) | g (1) | b (1) | delay ms (3)
+
+constexpr uint32_t ANIM_MAGIC = 0x31414C4C; // "LLA1"
+constexpr uint8_t ANIM_FLAG_LOOP = 0x01;
+constexpr uint8_t ANIM_FLAG_LZ = 0x02;
+constexpr size_t ANIM_HEADER_SIZE = 16;
+constexpr size_t ANIM_OP_SIZE = 8;
+constexpr uint32_t ANIM_MAX_DELAY = 0xFFFFFF;
+constexpr size_t ANIM_SLOT_SIZE = 0x10000;
+constexpr size_t ANIM_CHUNK_SIZE = 1000;
+constexpr size_t ANIM_LZ_WINDOW = 256;
+constexpr uint8_t ANIM_PARTITION_SUBTYPE = 0x40;
+
+struct AnimOp
+{
+    uint16_t index;
+    uint8_t r, g, b;
+    uint32_t delay;
+};
+
+struct AnimHeader
+{
+    uint32_t magic;
+    uint8_t flags;
+    uint16_t op_count;
+    uint32_t data_size;
+};
+
+inline bool anim_read_header(const uint8_t *blob, AnimHeader &h)
+{
+    h.magic = load_le(blob, 4);
+    h.flags = blob[4];
+    h.op_count = load_le(blob + 6, 2);
+    h.data_size = load_le(blob + 8, 4);
+
+    return h.magic == ANIM_MAGIC && h.data_size <= ANIM_SLOT_SIZE - ANIM_HEADER_SIZE;
+}
+
+// Byte-oriented LZ77 over a 256 byte window:
+//   0x00-0x7F  literal run of (t + 1) bytes that follow
+//   0x80-0xFF  match of ((t & 0x7F) + 3) bytes at distance (next byte + 1)
+inline size_t anim_lz_compress(const uint8_t *src, size_t len, uint8_t *out, size_t cap)
+{
+    size_t o = 0, i = 0, lit_start = 0;
+
+    auto flush_literals = [&](size_t upto) -> bool {
+        while (lit_start < upto)
+        {
+            const size_t run = upto - lit_start > 128 ? 128 : upto - lit_start;
+            if (o + 1 + run > cap)
+                return false;
+            out[o++] = run - 1;
+            std::memcpy(out + o, src + lit_start, run);
+            o += run;
+            lit_start += run;
+        }
+        return true;
+    };
+
+    while (i < len)
+    {
+        size_t best_len = 0, best_dist = 0;
+        const size_t max_dist = i < ANIM_LZ_WINDOW ? i : ANIM_LZ_WINDOW;
+
+        for (size_t dist = 1; dist <= max_dist; dist++)
+        {
+            size_t n = 0;
+            while (n < 130 && i + n < len && src[i + n] == src[i + n - dist])
+                n++;
+            if (n > best_len)
+            {
+                best_len = n;
+                best_dist = dist;
+            }
+        }
+
+        if (best_len < 3)
+        {
+            i++;
+            continue;
+        }
+
+        if (!flush_literals(i) || o + 2 > cap)
+            return 0;
+
+        out[o++] = 0x80 | (best_len - 3);
+        out[o++] = best_dist - 1;
+        i += best_len;
+        lit_start = i;
+    }
+
+    if (!flush_literals(len))
+        return 0;
+
+    return o;
+}
+
+// Builds a blob from decoded ops; meant for senders, not the render path.
+// Returns its size, or 0 if `cap` is too small.
+inline size_t anim_encode(const AnimOp *ops, uint16_t count, bool loop, bool compress, uint8_t *out, size_t cap)
+{
+    const size_t raw_size = size_t(count) * ANIM_OP_SIZE;
+
+    if (cap < ANIM_HEADER_SIZE + raw_size)
+        return 0;
+
+    uint8_t *raw = out + ANIM_HEADER_SIZE;
+
+    for (int i = 0; i < count; i++)
+    {
+        uint8_t *p = raw + i * ANIM_OP_SIZE;
+        store_le(p, ops[i].index, 2);
+        p[2] = ops[i].r;
+        p[3] = ops[i].g;
+        p[4] = ops[i].b;
+        store_le(p + 5, ops[i].delay > ANIM_MAX_DELAY ? ANIM_MAX_DELAY : ops[i].delay, 3);
+    }
+
+    uint8_t flags = loop ? ANIM_FLAG_LOOP : 0;
+    size_t data_size = raw_size;
+
+    if (compress)
+    {
+        std::vector<uint8_t> packed(raw_size);
+        const size_t n = anim_lz_compress(raw, raw_size, packed.data(), packed.size());
+
+        if (n > 0 && n < raw_size)
+        {
+            std::memcpy(raw, packed.data(), n);
+            flags |= ANIM_FLAG_LZ;
+            data_size = n;
+        }
+    }
+
+    std::memset(out, 0, ANIM_HEADER_SIZE);
+    store_le(out, ANIM_MAGIC, 4);
+    out[4] = flags;
+    store_le(out + 6, count, 2);
+    store_le(out + 8, data_size, 4);
+
+    return ANIM_HEADER_SIZE + data_size;
+}
+
+// Streams ops out of a blob in place. Raw blobs are read straight from the
+// mapping; LZ blobs only need the 256 byte window kept here.
+class AnimReader
+{
+private:
+    const uint8_t *data = nullptr;
+    AnimHeader header{};
+
+    size_t pos = 0;
+    uint16_t ops_left = 0;
+
+    uint8_t window[ANIM_LZ_WINDOW];
+    size_t window_pos = 0;
+    int literal_left = 0;
+    int match_left = 0;
+    size_t match_dist = 0;
+
+    bool next_byte(uint8_t &b)
+    {
+        while (literal_left == 0 && match_left == 0)
+        {
+            if (pos >= header.data_size)
+                return false;
+
+            const uint8_t t = data[pos++];
+
+            if (t < 0x80)
+            {
+                literal_left = t + 1;
+            }
+            else
+            {
+                if (pos >= header.data_size)
+                    return false;
+                match_left = (t & 0x7F) + 3;
+                match_dist = data[pos++] + 1;
+            }
+        }
+
+        if (literal_left > 0)
+        {
+            if (pos >= header.data_size)
+                return false;
+            b = data[pos++];
+            literal_left--;
+        }
+        else
+        {
+            b = window[(window_pos - match_dist) % ANIM_LZ_WINDOW];
+            match_left--;
+        }
+
+        window[window_pos++ % ANIM_LZ_WINDOW] = b;
+        return true;
+    }
+
+public:
+    bool begin(const uint8_t *blob)
+    {
+        if (blob == nullptr || !anim_read_header(blob, header))
+            return false;
+
+        data = blob + ANIM_HEADER_SIZE;
+        rewind();
+        return true;
+    }
+
+    void rewind()
+    {
+        pos = 0;
+        ops_left = header.op_count;
+        window_pos = 0;
+        literal_left = 0;
+        match_left = 0;
+    }
+
+    bool loop() const { return header.flags & ANIM_FLAG_LOOP; }
+
+    bool next(AnimOp &op)
+    {
+        if (ops_left == 0)
+            return false;
+
+        uint8_t buf[ANIM_OP_SIZE];
+        const uint8_t *p = buf;
+
+        if (header.flags & ANIM_FLAG_LZ)
+        {
+            for (auto &b : buf)
+                if (!next_byte(b))
+                    return false;
+        }
+        else
+        {
+            if (pos + ANIM_OP_SIZE > header.data_size)
+                return false;
+            p = data + pos;
+            pos += ANIM_OP_SIZE;
+        }
+
+        op.index = load_le(p, 2);
+        op.r = p[2];
+        op.g = p[3];
+        op.b = p[4];
+        op.delay = load_le(p + 5, 3);
+        ops_left--;
+        return true;
+    }
+};
+
+// Storage backends expose the same NOR-flash semantics: erase() sets bytes to
+// 0xFF, write() can only clear bits, and data() is a read-only mapping.
+#ifdef ESP_PLATFORM
+class AnimStorage
+{
+private:
+    const esp_partition_t *partition = nullptr;
+    const void *mapped = nullptr;
+    esp_partition_mmap_handle_t handle = 0;
+
+public:
+    // `name` is the partition label.
+    bool open(const char *name)
+    {
+        partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                             static_cast<esp_partition_subtype_t>(ANIM_PARTITION_SUBTYPE), name);
+        if (partition == nullptr)
+            return false;
+
+        return esp_partition_mmap(partition, 0, partition->size, ESP_PARTITION_MMAP_DATA, &mapped, &handle) ==
+               ESP_OK;
+    }
+
+    bool erase(size_t offset, size_t len) { return esp_partition_erase_range(partition, offset, len) == ESP_OK; }
+
+    bool write(size_t offset, const uint8_t *src, size_t len)
+    {
+        return esp_partition_write(partition, offset, src, len) == ESP_OK;
+    }
+
+    const uint8_t *data() const { return static_cast<const uint8_t *>(mapped); }
+
+    size_t size() const { return partition ? partition->size : 0; }
+
+    ~AnimStorage()
+    {
+        if (mapped != nullptr)
+            esp_partition_munmap(handle);
+    }
+};
+#else
+class AnimStorage
+{
+private:
+    int fd = -1;
+    uint8_t *mapped = nullptr;
+    size_t length = 0;
+
+public:
+    // `name` is the path of a file standing in for the partition; its size
+    // must be a multiple of ANIM_SLOT_SIZE.
+    bool open(const char *name)
+    {
+        struct stat st;
+
+        fd = ::open(name, O_RDWR);
+        if (fd < 0 || fstat(fd, &st) != 0 || st.st_size <= 0)
+            return false;
+
+        length = st.st_size;
+        void *p = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (p == MAP_FAILED)
+            return false;
+
+        mapped = static_cast<uint8_t *>(p);
+        return true;
+    }
+
+    bool erase(size_t offset, size_t len)
+    {
+        if (offset + len > length)
+            return false;
+        std::memset(mapped + offset, 0xFF, len);
+        return true;
+    }
+
+    bool write(size_t offset, const uint8_t *src, size_t len)
+    {
+        if (offset + len > length)
+            return false;
+        for (size_t i = 0; i < len; i++)
+            mapped[offset + i] &= src[i];
+        return true;
+    }
+
+    const uint8_t *data() const { return mapped; }
+
+    size_t size() const { return length; }
+
+    ~AnimStorage()
+    {
+        if (mapped != nullptr)
+            munmap(mapped, length);
+        if (fd >= 0)
+            close(fd);
+    }
+};
+#endif
+
+class AnimLibrary
+{
+public:
+    enum Error
+    {
+        STORAGE_NOT_FOUND,
+        INVALID_SLOT,
+        OUT_OF_ORDER,
+        TOO_SMALL,
+        TOO_LARGE,
+        SLOT_BUSY,
+        FLASH_ERROR
+    };
+
+private:
+    AnimStorage storage;
+    size_t slot_count = 0;
+
+    // Upload in progress. The magic is written last, so a slot only becomes
+    // playable once its final chunk has landed.
+    int upload_slot = -1;
+    uint16_t upload_next = 0;
+    uint8_t upload_magic[4];
+
+    // The render task streams `playing` straight out of the mapping, so it
+    // must not be erased underneath it. Each side publishes its slot before
+    // checking the other's, so at most one of them goes ahead.
+    std::atomic<int> playing{-1};
+    std::atomic<int> erasing{-1};
+
+    size_t slot_offset(uint8_t id) const { return size_t(id) * ANIM_SLOT_SIZE; }
+
+public:
+    Result<bool, Error> init(const char *name)
+    {
+        if (!storage.open(name))
+            return Result<bool, Error>(STORAGE_NOT_FOUND);
+
+        slot_count = storage.size() / ANIM_SLOT_SIZE;
+        return Result<bool, Error>(true);
+    }
+
+    size_t get_slot_count() const { return slot_count; }
+
+    // Chunk `seq` of `total`; every chunk but the last carries exactly
+    // ANIM_CHUNK_SIZE bytes. Chunk 0 erases the slot, and is refused with
+    // SLOT_BUSY while that slot is playing.
+    Result<bool, Error> upload(uint8_t id, uint16_t seq, uint16_t total, const uint8_t *chunk, size_t len)
+    {
+        if (id >= slot_count)
+            return Result<bool, Error>(INVALID_SLOT);
+
+        if (total == 0 || seq >= total || (seq + 1 < total && len != ANIM_CHUNK_SIZE))
+            return Result<bool, Error>(OUT_OF_ORDER);
+
+        if (size_t(seq) * ANIM_CHUNK_SIZE + len > ANIM_SLOT_SIZE)
+            return Result<bool, Error>(TOO_LARGE);
+
+        if (seq == 0)
+        {
+            if (len < ANIM_HEADER_SIZE)
+                return Result<bool, Error>(TOO_SMALL);
+
+            upload_slot = -1;
+            erasing.store(id);
+
+            if (playing.load() == id)
+            {
+                erasing.store(-1);
+                return Result<bool, Error>(SLOT_BUSY);
+            }
+
+            // Once erased the slot has no magic, so playback can't start on
+            // it again until the upload completes.
+            const bool erased = storage.erase(slot_offset(id), ANIM_SLOT_SIZE);
+            erasing.store(-1);
+
+            if (!erased)
+                return Result<bool, Error>(FLASH_ERROR);
+
+            upload_slot = id;
+            upload_next = 0;
+            std::memcpy(upload_magic, chunk, sizeof(upload_magic));
+            chunk += sizeof(upload_magic);
+            len -= sizeof(upload_magic);
+        }
+        else if (upload_slot != id || upload_next != seq)
+        {
+            upload_slot = -1;
+            return Result<bool, Error>(OUT_OF_ORDER);
+        }
+
+        const size_t offset = slot_offset(id) + size_t(seq) * ANIM_CHUNK_SIZE + (seq == 0 ? sizeof(upload_magic) : 0);
+
+        if (!storage.write(offset, chunk, len))
+        {
+            upload_slot = -1;
+            return Result<bool, Error>(FLASH_ERROR);
+        }
+
+        upload_next++;
+
+        if (upload_next == total)
+        {
+            upload_slot = -1;
+            if (!storage.write(slot_offset(id), upload_magic, sizeof(upload_magic)))
+                return Result<bool, Error>(FLASH_ERROR);
+        }
+
+        return Result<bool, Error>(true);
+    }
+
+    // Render side. Marks slot `id` as streaming; false if it is being erased,
+    // in which case it must not be read. Every successful call must be
+    // paired with end_playback().
+    bool begin_playback(uint8_t id)
+    {
+        playing.store(id);
+
+        if (erasing.load() == id)
+        {
+            playing.store(-1);
+            return false;
+        }
+
+        return true;
+    }
+
+    void end_playback() { playing.store(-1); }
+
+    // Returns the mapped blob of slot `id`, or nullptr if it holds none.
+    const uint8_t *find(uint8_t id) const
+    {
+        AnimHeader h;
+
+        if (id >= slot_count || storage.data() == nullptr)
+            return nullptr;
+
+        const uint8_t *blob = storage.data() + slot_offset(id);
+        return anim_read_header(blob, h) ? blob : nullptr;
+    }
+};
+
+#endif // ANIM_HPP
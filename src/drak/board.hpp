@@ -0,0 +1,11 @@
+#ifndef BOARD_HPP
+#define BOARD_HPP
+
+#include "strip.hpp"
+
+// The attached strip: LED model, colour order, length and data GPIO.
+using BoardStrip = StripConfig<SK6812, ColorOrder::GRB, 60, 12>;
+
+constexpr int LED_COUNT = BoardStrip::count;
+
+#endif // BOARD_HPP
@@ -0,0 +1,23 @@
+#ifndef BYTES_HPP
+#define BYTES_HPP
+
+#include <cstdint>
+
+// Every multi-byte field on the wire and in stored blobs is little-endian.
+// Byte by byte, so the same code reads unaligned fields on any host.
+
+inline uint64_t load_le(const uint8_t *p, int n)
+{
+    uint64_t v = 0;
+    for (int i = n - 1; i >= 0; i--)
+        v = (v << 8) | p[i];
+    return v;
+}
+
+inline void store_le(uint8_t *p, uint64_t v, int n)
+{
+    for (int i = 0; i < n; i++, v >>= 8)
+        p[i] = v & 0xFF;
+}
+
+#endif // BYTES_HPP
@@ -0,0 +1,172 @@
+#ifndef CAPTURE_HPP
+#define CAPTURE_HPP
+
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "lwip/sockets.h"
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+namespace UDP
+{
+  // Dump layout, little-endian: the 8 byte magic, then one record per datagram:
+  //   timestamp us (u64) | sender ipv4, network order (4) | sender port (u16) | length (u16) | payload
+  constexpr size_t CAPTURE_BUFFER_SIZE = 32 * 1024;
+  constexpr size_t CAPTURE_RECORD_HEADER_SIZE = 16;
+  constexpr uint8_t CAPTURE_MAGIC[8] = {'L', 'L', 'C', 'A', 'P', '1', 0, 0};
+
+#ifdef LLC_STATIC_ALLOC
+  // Reserved up front so starting a capture never touches the heap.
+  inline uint8_t capture_arena[CAPTURE_BUFFER_SIZE];
+#endif
+
+  // Ring of timestamped datagrams. When full, the oldest records are evicted.
+  // A dump holds the lock while it streams; recording only tries the lock and
+  // skips the datagram when it is held, so a slow reader never holds up the
+  // receive task. With LLC_STATIC_ALLOC the ring is the fixed
+  // capture_arena and `enable()` ignores its size argument.
+  class Capture
+  {
+  private:
+    uint8_t *buffer = nullptr;
+    size_t capacity = 0;
+    size_t head = 0;
+    size_t tail = 0;
+    size_t used = 0;
+
+    std::atomic<bool> enabled{false};
+    SemaphoreHandle_t mutex;
+
+    static void store_le(uint8_t *p, uint64_t v, int n)
+    {
+      for (int i = 0; i < n; i++, v >>= 8)
+        p[i] = v & 0xFF;
+    }
+
+    void put(const uint8_t *src, size_t len)
+    {
+      const size_t first = len < capacity - head ? len : capacity - head;
+      std::memcpy(buffer + head, src, first);
+      std::memcpy(buffer, src + first, len - first);
+      head = (head + len) % capacity;
+      used += len;
+    }
+
+    void get(size_t pos, uint8_t *dst, size_t len) const
+    {
+      const size_t first = len < capacity - pos ? len : capacity - pos;
+      std::memcpy(dst, buffer + pos, first);
+      std::memcpy(dst + first, buffer, len - first);
+    }
+
+    size_t record_size_at(size_t pos) const
+    {
+      uint8_t header[CAPTURE_RECORD_HEADER_SIZE];
+      get(pos, header, sizeof(header));
+      return CAPTURE_RECORD_HEADER_SIZE + (header[14] | header[15] << 8);
+    }
+
+  public:
+    Capture()
+    {
+      mutex = xSemaphoreCreateMutex();
+    }
+
+    bool enable(size_t bytes = CAPTURE_BUFFER_SIZE)
+    {
+      xSemaphoreTake(mutex, portMAX_DELAY);
+      if (buffer == nullptr)
+      {
+#ifdef LLC_STATIC_ALLOC
+        buffer = capture_arena;
+        bytes = sizeof(capture_arena);
+#else
+        buffer = static_cast<uint8_t *>(malloc(bytes));
+#endif
+        capacity = buffer ? bytes : 0;
+        head = tail = used = 0;
+      }
+      enabled = buffer != nullptr;
+      xSemaphoreGive(mutex);
+      return enabled;
+    }
+
+    void disable()
+    {
+      enabled = false;
+    }
+
+    bool is_enabled() const { return enabled; }
+
+    void record(const struct sockaddr_in &from, const char *data, size_t len)
+    {
+      if (!enabled)
+        return;
+
+      const size_t size = CAPTURE_RECORD_HEADER_SIZE + len;
+
+      if (xSemaphoreTake(mutex, 0) != pdTRUE)
+        return;
+
+      if (buffer != nullptr && size <= capacity)
+      {
+        while (capacity - used < size)
+        {
+          const size_t oldest = record_size_at(tail);
+          tail = (tail + oldest) % capacity;
+          used -= oldest;
+        }
+
+        uint8_t header[CAPTURE_RECORD_HEADER_SIZE];
+        store_le(header, esp_timer_get_time(), 8);
+        std::memcpy(header + 8, &from.sin_addr.s_addr, 4);
+        store_le(header + 12, ntohs(from.sin_port), 2);
+        store_le(header + 14, len, 2);
+
+        put(header, sizeof(header));
+        put(reinterpret_cast<const uint8_t *>(data), len);
+      }
+      xSemaphoreGive(mutex);
+    }
+
+    // Streams the capture, oldest first, as `sink(const uint8_t *, size_t)`
+    // calls. Returns the number of records written.
+    template <typename Sink>
+    size_t dump(Sink &&sink)
+    {
+      xSemaphoreTake(mutex, portMAX_DELAY);
+
+      size_t records = 0;
+      sink(CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC));
+
+      for (size_t pos = tail, left = used; left > 0; records++)
+      {
+        const size_t size = record_size_at(pos);
+        const size_t first = size < capacity - pos ? size : capacity - pos;
+
+        sink(buffer + pos, first);
+        if (size > first)
+          sink(buffer, size - first);
+
+        pos = (pos + size) % capacity;
+        left -= size;
+      }
+
+      xSemaphoreGive(mutex);
+      return records;
+    }
+
+    ~Capture()
+    {
+#ifndef LLC_STATIC_ALLOC
+      free(buffer);
+#endif
+      vSemaphoreDelete(mutex);
+    }
+  };
+}
+
+#endif // CAPTURE_HPP
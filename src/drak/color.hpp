@@ -1,6 +1,9 @@
 #ifndef COLOR_HPP
 #define COLOR_HPP
 
+#include <cstdint>
+#include <cstdlib>
+
 #define MIN(a, b) ((a) < (b) ? (a) : (b))
 #define MAX(a, b) ((a) > (b) ? (a) : (b))
 
@@ -94,4 +97,106 @@ RGB hsl2rgb(float h, float s, float l)
   return result;
 }
 
+// Integer HSL for per-frame work: h in [0, HSL_HUE_RANGE) with 256 steps per
+// 60 degree sector, s and l in [0, 255].
+constexpr int HSL_HUE_RANGE = 6 * 256;
+
+typedef struct hsl_int
+{
+  uint16_t h;
+  uint8_t s, l;
+} HSLInt;
+
+inline HSLInt rgb2hsl_int(uint8_t r, uint8_t g, uint8_t b)
+{
+  const int max = MAX(MAX(r, g), b);
+  const int min = MIN(MIN(r, g), b);
+  const int d = max - min;
+
+  HSLInt result;
+  result.l = (max + min) / 2;
+
+  if (d == 0)
+  {
+    result.h = result.s = 0; // achromatic
+    return result;
+  }
+
+  result.s = d * 255 / (result.l < 128 ? max + min : 510 - max - min);
+
+  int h;
+  if (max == r)
+    h = (g - b) * 256 / d;
+  else if (max == g)
+    h = 512 + (b - r) * 256 / d;
+  else
+    h = 1024 + (r - g) * 256 / d;
+
+  result.h = h < 0 ? h + HSL_HUE_RANGE : h;
+  return result;
+}
+
+inline void hsl2rgb_int(HSLInt hsl, uint8_t *rgb)
+{
+  const int c = (255 - abs(2 * hsl.l - 255)) * hsl.s / 255;
+  const int x = c * (256 - abs(hsl.h % 512 - 256)) / 256;
+  const int m = hsl.l - c / 2;
+
+  int r, g, b;
+  switch (hsl.h / 256)
+  {
+  case 0: r = c, g = x, b = 0; break;
+  case 1: r = x, g = c, b = 0; break;
+  case 2: r = 0, g = c, b = x; break;
+  case 3: r = 0, g = x, b = c; break;
+  case 4: r = x, g = 0, b = c; break;
+  default: r = c, g = 0, b = x; break;
+  }
+
+  rgb[0] = MIN(MAX(r + m, 0), 255);
+  rgb[1] = MIN(MAX(g + m, 0), 255);
+  rgb[2] = MIN(MAX(b + m, 0), 255);
+}
+
+// Whole-frame colour transform: hue rotation, saturation and lightness
+// scaling in HSL, then a blend towards a tint colour.
+struct ColorTransform
+{
+  uint16_t hue_shift = 0;      // in HSL_HUE_RANGE units
+  uint16_t saturation = 256;   // 8.8 fixed point, 256 = unchanged
+  uint16_t lightness = 256;    // 8.8 fixed point, 256 = unchanged
+  uint8_t tint[3] = {0, 0, 0};
+  uint8_t tint_amount = 0;     // 0 = none, 255 = solid tint
+
+  bool is_identity() const
+  {
+    return hue_shift == 0 && saturation == 256 && lightness == 256 && tint_amount == 0;
+  }
+
+  // Transforms `n` RGB pixels from `src` into `dst`.
+  void apply(const uint8_t *src, uint8_t *dst, int n) const
+  {
+    const bool hsl = hue_shift != 0 || saturation != 256 || lightness != 256;
+
+    for (int i = 0; i < n; i++, src += 3, dst += 3)
+    {
+      if (hsl)
+      {
+        HSLInt c = rgb2hsl_int(src[0], src[1], src[2]);
+        c.h = (c.h + hue_shift) % HSL_HUE_RANGE;
+        c.s = MIN(c.s * saturation >> 8, 255);
+        c.l = MIN(c.l * lightness >> 8, 255);
+        hsl2rgb_int(c, dst);
+      }
+      else
+      {
+        dst[0] = src[0], dst[1] = src[1], dst[2] = src[2];
+      }
+
+      for (int k = 0; k < 3; k++)
+        dst[k] += (tint[k] - dst[k]) * tint_amount / 255;
+    }
+  }
+};
+
 #endif
\ No newline at end of file
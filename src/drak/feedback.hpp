@@ -0,0 +1,256 @@
+#ifndef FEEDBACK_HPP
+#define FEEDBACK_HPP
+
+#include "bytes.hpp"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "light_lang.hpp"
+#include "metrics.hpp"
+#include "pipeline.hpp"
+#include "result.hpp"
+#include "strip.hpp"
+#include "udp.hpp"
+#include <atomic>
+#include <cstring>
+#include <string_view>
+
+// Device-to-sender feedback, all little-endian:
+//
+//   sender -> device  'D'                               discovery ping
+//   device -> sender  'd' + status                      discovery reply
+//   device -> sender  's' + status                      periodic advertisement
+//   device -> sender  'a' + result (u8) + request head  ack of 'C', 'U', 'P', 'L', 'S', 'Y'
+//
+// status: version (u8) | led count (u16) | fps x10 (u16) | max fps x10 (u16) |
+//         queue depth (u8) | queue capacity (u8) | drop rate per mille (u16)
+//
+// The request head echoed in an ack is the header of the acked message (tag
+// and ids), so senders can match it to what they sent.
+
+constexpr char FB_DISCOVER = 'D';
+constexpr char FB_DISCOVER_REPLY = 'd';
+constexpr char FB_STATUS = 's';
+constexpr char FB_ACK = 'a';
+constexpr uint8_t FB_VERSION = 1;
+constexpr int FB_STATUS_SIZE = 11;
+constexpr int FB_MAX_PEERS = 4;
+constexpr int64_t FB_PEER_TIMEOUT_US = 5 * 1000 * 1000;
+constexpr uint64_t FB_ADVERTISE_INTERVAL_US = 1000 * 1000;
+
+class Feedback
+{
+public:
+    enum Error
+    {
+        FAILED_CREATE_TIMER,
+        FAILED_START_TIMER
+    };
+
+private:
+    struct Peer
+    {
+        char ip[16];
+        uint16_t port;
+        int endpoint;
+        int64_t last_seen;
+    };
+
+    Pipeline &pipeline;
+    // Set by the receive task on the first message, read by the timer.
+    std::atomic<UDP::Server *> server{nullptr};
+    esp_timer_handle_t timer = nullptr;
+    SemaphoreHandle_t peers_mutex;
+
+    Peer peers[FB_MAX_PEERS] = {};
+
+    // Rates over the last advertisement interval; only the timer writes them.
+    uint32_t last_frames = 0;
+    uint32_t last_received = 0;
+    uint32_t last_dropped = 0;
+    int64_t last_sample_us = 0;
+    uint16_t fps_x10 = 0;
+    uint16_t drop_permille = 0;
+
+    static void on_timer(void *arg) { static_cast<Feedback *>(arg)->advertise(); }
+
+    static uint16_t saturate_u16(uint64_t v) { return v > UINT16_MAX ? UINT16_MAX : v; }
+
+    // From the measured mean wire time; the histogram's log2 buckets are too
+    // coarse for this and could understate the rate by up to half.
+    static uint16_t max_fps_x10()
+    {
+        uint32_t wire_us = metrics.get_transmit_mean_us();
+
+        if (wire_us == 0)
+            wire_us = BoardStrip::frame_wire_us;
+
+        return saturate_u16(uint64_t(10) * 1000 * 1000 / (wire_us + BoardStrip::model::reset_us));
+    }
+
+    void sample()
+    {
+        const int64_t now = esp_timer_get_time();
+        const uint32_t frames = metrics.get_frames_rendered();
+        const uint32_t received = metrics.get_packets_received();
+        const uint32_t dropped = metrics.get_packets_dropped();
+
+        if (last_sample_us != 0 && now > last_sample_us)
+        {
+            fps_x10 = saturate_u16(uint64_t(frames - last_frames) * 10 * 1000 * 1000 / (now - last_sample_us));
+            drop_permille = received == last_received ? 0 : (dropped - last_dropped) * 1000 / (received - last_received);
+        }
+
+        last_frames = frames;
+        last_received = received;
+        last_dropped = dropped;
+        last_sample_us = now;
+    }
+
+    size_t write_status(char tag, uint8_t *out) const
+    {
+        out[0] = tag;
+        out[1] = FB_VERSION;
+        store_le(out + 2, LED_COUNT, 2);
+        store_le(out + 4, fps_x10, 2);
+        store_le(out + 6, max_fps_x10(), 2);
+        out[8] = pipeline.get_queue_depth();
+        out[9] = Pipeline::get_queue_capacity();
+        store_le(out + 10, drop_permille, 2);
+        return 1 + FB_STATUS_SIZE;
+    }
+
+    void note_peer(int endpoint, const char *ip, uint16_t port)
+    {
+        const int64_t now = esp_timer_get_time();
+        Peer *slot = &peers[0];
+
+        xSemaphoreTake(peers_mutex, portMAX_DELAY);
+        for (auto &p : peers)
+        {
+            if (p.port == port && std::strcmp(p.ip, ip) == 0)
+            {
+                slot = &p;
+                break;
+            }
+            if (p.last_seen < slot->last_seen)
+                slot = &p;
+        }
+
+        std::strncpy(slot->ip, ip, sizeof(slot->ip) - 1);
+        slot->port = port;
+        slot->endpoint = endpoint;
+        slot->last_seen = now;
+        xSemaphoreGive(peers_mutex);
+    }
+
+    void advertise()
+    {
+        sample();
+
+        UDP::Server *s = server.load(std::memory_order_acquire);
+
+        if (s == nullptr)
+            return;
+
+        uint8_t msg[1 + FB_STATUS_SIZE];
+        const size_t len = write_status(FB_STATUS, msg);
+        const int64_t now = esp_timer_get_time();
+
+        xSemaphoreTake(peers_mutex, portMAX_DELAY);
+        for (const auto &p : peers)
+            if (p.port != 0 && now - p.last_seen < FB_PEER_TIMEOUT_US)
+                s->send_to(p.endpoint, p.ip, p.port, msg, len);
+        xSemaphoreGive(peers_mutex);
+    }
+
+    static size_t request_head_size(char tag)
+    {
+        switch (tag)
+        {
+        case LL_COMMIT:
+            return LL_COMMIT_SIZE;
+        case LL_UPLOAD:
+            return LL_UPLOAD_HEADER_SIZE;
+        case LL_PLAY:
+            return LL_PLAY_SIZE;
+        case LL_LAYOUT:
+            return LL_LAYOUT_HEADER_SIZE;
+        case LL_SYNC:
+            return LL_SYNC_SIZE;
+        case LL_LATCH:
+            return LL_LATCH_SIZE;
+        default:
+            return 0;
+        }
+    }
+
+public:
+    explicit Feedback(Pipeline &p) : pipeline(p)
+    {
+        peers_mutex = xSemaphoreCreateMutex();
+    }
+
+    Result<bool, Error> start()
+    {
+        const esp_timer_create_args_t args = {
+            .callback = &Feedback::on_timer,
+            .arg = this,
+            .dispatch_method = ESP_TIMER_TASK,
+            .name = "llc_feedback",
+        };
+
+        if (esp_timer_create(&args, &timer) != ESP_OK)
+            return Result<bool, Error>(FAILED_CREATE_TIMER);
+
+        if (esp_timer_start_periodic(timer, FB_ADVERTISE_INTERVAL_US) != ESP_OK)
+            return Result<bool, Error>(FAILED_START_TIMER);
+
+        return Result<bool, Error>(true);
+    }
+
+    // Answers a discovery ping from the endpoint it arrived on. Returns true
+    // if `data` was one, in which case it must not be passed on to the pipeline.
+    bool answer_discovery(UDP::Server *s, int endpoint, std::string_view data, const char *ip, uint16_t port)
+    {
+        if (data.length() != 1 || data[0] != FB_DISCOVER)
+            return false;
+
+        uint8_t msg[1 + FB_STATUS_SIZE];
+        const size_t len = write_status(FB_DISCOVER_REPLY, msg);
+        s->send_to(endpoint, ip, port, msg, len);
+        return true;
+    }
+
+    // Registers the sender for advertisements and acks control messages, both
+    // sent from the endpoint the sender last used.
+    void acknowledge(UDP::Server *s, int endpoint, std::string_view data, const char *ip, uint16_t port,
+                     LightLangResult result)
+    {
+        server.store(s, std::memory_order_release);
+        note_peer(endpoint, ip, port);
+
+        const size_t head = data.empty() ? 0 : request_head_size(data[0]);
+
+        if (head == 0 || data.length() < head)
+            return;
+
+        uint8_t msg[2 + LL_LATCH_SIZE];
+        msg[0] = FB_ACK;
+        msg[1] = result;
+        std::memcpy(msg + 2, data.data(), head);
+        s->send_to(endpoint, ip, port, msg, 2 + head);
+    }
+
+    ~Feedback()
+    {
+        if (timer != nullptr)
+        {
+            esp_timer_stop(timer);
+            esp_timer_delete(timer);
+        }
+        vSemaphoreDelete(peers_mutex);
+    }
+};
+
+#endif // FEEDBACK_HPP
@@ -0,0 +1,194 @@
+#ifndef FRAME_HPP
+#define FRAME_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include "esp_timer.h"
+
+constexpr int MAX_FRAME_FRAGMENTS = 64;
+constexpr int64_t FRAME_TIMEOUT_US = 200 * 1000;
+
+// Written by the receive task, read by the metrics server: relaxed atomics,
+// like the other counters in Metrics.
+struct FrameStats
+{
+    std::atomic<uint32_t> frames_completed{0};
+    std::atomic<uint32_t> frames_committed{0};
+    std::atomic<uint32_t> frames_dropped{0};
+    std::atomic<uint32_t> fragments_rejected{0};
+
+    static void count(std::atomic<uint32_t> &counter) { counter.fetch_add(1, std::memory_order_relaxed); }
+};
+
+// Collects the fragments of one frame into a back buffer. The front buffer
+// keeps the last presented frame, so LEDs a frame does not touch keep their
+// colour and a dropped frame never leaks half-written pixels.
+template <int N>
+class FrameAssembler
+{
+private:
+    uint8_t front[N * 3] = {};
+    uint8_t back[N * 3] = {};
+
+    bool active = false;
+    bool has_id = false;
+    uint16_t frame_id = 0;
+    uint8_t fragment_count = 0;
+    uint64_t received_mask = 0;
+    int64_t started_at = 0;
+    int64_t last_seen = 0;
+
+    FrameStats stats;
+
+    // Serial number arithmetic over the 16 bit id space (RFC 1982). An older
+    // id is only stale while the newer frame is recent; after a quiet spell
+    // any id starts a new sequence, so a restarted sender is not locked out.
+    bool is_stale(uint16_t id, int64_t now) const
+    {
+        return has_id && int16_t(id - frame_id) < 0 && now - last_seen <= FRAME_TIMEOUT_US;
+    }
+
+    void drop()
+    {
+        if (active)
+            FrameStats::count(stats.frames_dropped);
+
+        active = false;
+        received_mask = 0;
+    }
+
+    void present()
+    {
+        std::memcpy(front, back, sizeof(front));
+        active = false;
+        received_mask = 0;
+    }
+
+public:
+    // Discards the frame in progress once it has been waiting longer than
+    // FRAME_TIMEOUT_US.
+    void expire(int64_t now)
+    {
+        if (active && now - started_at > FRAME_TIMEOUT_US)
+            drop();
+    }
+
+    // Returns false if the fragment must be ignored: bad header, a stale
+    // frame id or a fragment that already arrived. A newer id abandons the
+    // frame in progress; an older one never does.
+    bool begin_fragment(uint16_t id, uint8_t index, uint8_t count)
+    {
+        const int64_t now = esp_timer_get_time();
+        expire(now);
+
+        if (count == 0 || count > MAX_FRAME_FRAGMENTS || index >= count || is_stale(id, now) ||
+            (!active && has_id && id == frame_id))
+        {
+            FrameStats::count(stats.fragments_rejected);
+            return false;
+        }
+
+        if (!active || id != frame_id)
+        {
+            drop();
+            std::memcpy(back, front, sizeof(back));
+            active = true;
+            has_id = true;
+            frame_id = id;
+            fragment_count = count;
+            started_at = now;
+        }
+
+        last_seen = now;
+
+        const uint64_t bit = uint64_t(1) << index;
+
+        if (count != fragment_count || (received_mask & bit))
+        {
+            FrameStats::count(stats.fragments_rejected);
+            return false;
+        }
+
+        received_mask |= bit;
+        return true;
+    }
+
+    void set_pixel(int index, uint8_t r, uint8_t g, uint8_t b)
+    {
+        if (index < 0 || index >= N)
+            return;
+
+        back[index * 3 + 0] = r;
+        back[index * 3 + 1] = g;
+        back[index * 3 + 2] = b;
+    }
+
+    // For packets that bypass fragment assembly, so the next frame starts
+    // from what they left on the strip. A frame in progress sees the write
+    // too; whichever arrives last wins.
+    void write_through(int index, uint8_t r, uint8_t g, uint8_t b)
+    {
+        if (index < 0 || index >= N)
+            return;
+
+        front[index * 3 + 0] = r;
+        front[index * 3 + 1] = g;
+        front[index * 3 + 2] = b;
+
+        if (active)
+            std::memcpy(&back[index * 3], &front[index * 3], 3);
+    }
+
+    void write_through(const uint8_t *pixels)
+    {
+        std::memcpy(front, pixels, sizeof(front));
+
+        if (active)
+            std::memcpy(back, pixels, sizeof(back));
+    }
+
+    // Presents the frame once every fragment has arrived.
+    bool finish_fragment()
+    {
+        const uint64_t all = fragment_count >= 64 ? ~uint64_t(0) : (uint64_t(1) << fragment_count) - 1;
+
+        if (!active || received_mask != all)
+            return false;
+
+        FrameStats::count(stats.frames_completed);
+        present();
+        return true;
+    }
+
+    // True if frame `id` was the last one presented, e.g. it completed on
+    // its final fragment before the sender's commit arrived.
+    bool is_presented(uint16_t id) const { return !active && has_id && id == frame_id; }
+
+    // Presents whatever arrived of frame `id`, for senders that cannot
+    // guarantee the fragment count up front. A commit for a frame that
+    // already completed is ignored, not counted as rejected.
+    bool commit(uint16_t id)
+    {
+        expire(esp_timer_get_time());
+
+        if (is_presented(id))
+            return false;
+
+        if (!active || id != frame_id)
+        {
+            FrameStats::count(stats.fragments_rejected);
+            return false;
+        }
+
+        FrameStats::count(stats.frames_committed);
+        present();
+        return true;
+    }
+
+    const uint8_t *pixels() const { return front; }
+
+    const FrameStats &get_stats() const { return stats; }
+};
+
+#endif // FRAME_HPP
@@ -0,0 +1,56 @@
+#ifndef GOVERNOR_HPP
+#define GOVERNOR_HPP
+
+#include "board.hpp"
+#include "freertos/FreeRTOS.h"
+#include <cstdint>
+
+// Slowest pass rate a looping render settles to while its frames stop changing.
+constexpr uint32_t GOVERNOR_IDLE_FPS = 10;
+
+// An unchanged frame is re-sent after this long anyway, so a glitch on the
+// data line never sticks. 0 disables the keep-alive.
+constexpr int64_t REFRESH_KEEPALIVE_US = 1000 * 1000;
+
+// Paces looping renders. While passes keep changing the frame, the next pass
+// may start as soon as the strip can take it: one frame on the wire plus the
+// reset gap. Every unchanged pass doubles the pause up to the idle floor, and
+// the first change snaps it back to full rate.
+class RefreshGovernor
+{
+public:
+    static constexpr uint32_t min_interval_us = BoardStrip::frame_wire_us + BoardStrip::model::reset_us;
+    static constexpr uint32_t max_interval_us = 1000 * 1000 / GOVERNOR_IDLE_FPS;
+
+    static_assert(min_interval_us <= max_interval_us, "strip is too long for the idle floor");
+
+private:
+    uint32_t interval_us = min_interval_us;
+
+public:
+    void update(bool changed)
+    {
+        if (changed)
+            interval_us = min_interval_us;
+        else if (interval_us < max_interval_us)
+            interval_us = interval_us * 2 < max_interval_us ? interval_us * 2 : max_interval_us;
+    }
+
+    uint32_t get_interval_us() const { return interval_us; }
+
+    // Extra pause before the next pass: none at full rate, where the strip's
+    // own transmit time paces the loop, otherwise the interval rounded up to
+    // whole ticks. The render task can only sleep in ticks, so the first
+    // backoff step is one tick (10 ms at CONFIG_FREERTOS_HZ=100) and the
+    // steps below it collapse into it.
+    uint32_t get_pass_delay_ms() const
+    {
+        if (interval_us == min_interval_us)
+            return 0;
+
+        const uint32_t tick_us = portTICK_PERIOD_MS * 1000;
+        return (interval_us + tick_us - 1) / tick_us * portTICK_PERIOD_MS;
+    }
+};
+
+#endif // GOVERNOR_HPP
@@ -0,0 +1,66 @@
+#ifndef HEX_HPP
+#define HEX_HPP
+
+#include <cstdint>
+#include <cstring>
+
+// Whole-record hex decoding. A Light Lang record is 16 ASCII hex digits,
+// i.e. two 64-bit words, so all digits are converted and checked a word at
+// a time (SWAR) instead of field by field.
+
+constexpr uint64_t HEX_ONES = 0x0101010101010101ULL;
+constexpr uint64_t HEX_HIGH = 0x8080808080808080ULL;
+
+// Sets the high bit of every byte of `x` that lies strictly between m and n.
+// Only valid for bytes below 0x80, which the caller checks separately.
+inline uint64_t hex_swar_between(uint64_t x, uint64_t m, uint64_t n)
+{
+    const uint64_t low = x & (HEX_ONES * 127);
+    return (HEX_ONES * (127 + n) - low) & ~x & (low + HEX_ONES * (127 - m)) & HEX_HIGH;
+}
+
+// Branch-free SWAR conversion of 8 digits: returns false if any byte is not
+// [0-9A-Fa-f]. Bit 6 is set exactly for letters, which then need +9.
+inline bool hex_decode8_swar(const char *src, uint8_t *nibbles)
+{
+    uint64_t x;
+    std::memcpy(&x, src, sizeof(x));
+
+    const uint64_t digit = hex_swar_between(x, '0' - 1, '9' + 1);
+    const uint64_t letter = hex_swar_between(x | (HEX_ONES * 0x20), 'a' - 1, 'f' + 1);
+    const bool valid = ((digit | letter) == HEX_HIGH) & ((x & HEX_HIGH) == 0);
+
+    const uint64_t values = (x & (HEX_ONES * 0x0F)) + ((x >> 6) & HEX_ONES) * 9;
+    std::memcpy(nibbles, &values, sizeof(values));
+
+    return valid;
+}
+
+// Converts 16 ASCII hex digits into their values; returns false if any of
+// them is not a hex digit. `nibbles` is always fully written.
+inline bool hex_decode16(const char *src, uint8_t *nibbles)
+{
+    const bool lo = hex_decode8_swar(src, nibbles);
+    const bool hi = hex_decode8_swar(src + 8, nibbles + 8);
+    return lo & hi;
+}
+
+// Parses a short field of up to 8 hex digits, for packet headers.
+inline bool hex_parse(const char *src, int len, uint32_t &out)
+{
+    char buf[8];
+    uint8_t nibbles[8];
+
+    std::memset(buf, '0', sizeof(buf));
+    std::memcpy(buf + sizeof(buf) - len, src, len);
+
+    const bool valid = hex_decode8_swar(buf, nibbles);
+
+    out = 0;
+    for (const uint8_t n : nibbles)
+        out = (out << 4) | n;
+
+    return valid;
+}
+
+#endif // HEX_HPP
@@ -0,0 +1,152 @@
+#ifndef LAYOUT_HPP
+#define LAYOUT_HPP
+
+#include "bytes.hpp"
+#include "result.hpp"
+#include <cstdint>
+
+constexpr uint16_t LAYOUT_UNMAPPED = 0xFFFF;
+
+// Largest logical grid a layout may describe, e.g. 32 x 32. It is sized
+// apart from the LED count, so a sparse fixture can sit on a grid with
+// many more cells than LEDs.
+constexpr int LAYOUT_MAX_CELLS = 1024;
+
+// Wiring of a matrix, as seen from the front with LED 0 at the top left.
+enum LayoutFlags : uint8_t
+{
+    LAYOUT_SERPENTINE = 0x01, // every other row (or column) runs backwards
+    LAYOUT_COLUMNS = 0x02,    // the strip runs down columns instead of along rows
+    LAYOUT_FLIP_X = 0x04,
+    LAYOUT_FLIP_Y = 0x08,
+    LAYOUT_ROTATION = 0x30, // quarter turns clockwise, in bits 4-5
+    LAYOUT_TABLE = 0x40     // an explicit coordinate table follows
+};
+
+// Logical to physical LED index lookup table.
+//
+// Senders address LEDs by logical index, y * width + x on the grid they see.
+// The table has one entry per logical cell, up to L, and is built once when
+// a layout is set, so remapping costs one load per pixel. The default layout
+// is the identity: one row of N LEDs.
+template <int N, int L = LAYOUT_MAX_CELLS>
+class Layout
+{
+    static_assert(L >= N, "the logical grid must fit one row of every LED");
+
+public:
+    enum Error
+    {
+        INVALID_SIZE,
+        INVALID_TABLE
+    };
+
+private:
+    uint16_t lut[L];
+    uint16_t width = N;
+    uint16_t height = 1;
+
+    void clear()
+    {
+        for (auto &p : lut)
+            p = LAYOUT_UNMAPPED;
+    }
+
+public:
+    Layout()
+    {
+        clear();
+        for (int i = 0; i < N; i++)
+            lut[i] = i;
+    }
+
+    // Builds the table for a w x h matrix wired as described by `flags`.
+    Result<bool, Error> set_matrix(uint16_t w, uint16_t h, uint8_t flags)
+    {
+        if (w == 0 || h == 0 || uint32_t(w) * h > L)
+            return Result<bool, Error>(INVALID_SIZE);
+
+        const int turns = (flags & LAYOUT_ROTATION) >> 4;
+        const int logical_width = turns & 1 ? h : w;
+
+        clear();
+
+        for (int p = 0; p < N && p < w * h; p++)
+        {
+            int x, y;
+
+            if (flags & LAYOUT_COLUMNS)
+            {
+                x = p / h;
+                y = (flags & LAYOUT_SERPENTINE) && (x & 1) ? h - 1 - p % h : p % h;
+            }
+            else
+            {
+                y = p / w;
+                x = (flags & LAYOUT_SERPENTINE) && (y & 1) ? w - 1 - p % w : p % w;
+            }
+
+            if (flags & LAYOUT_FLIP_X)
+                x = w - 1 - x;
+            if (flags & LAYOUT_FLIP_Y)
+                y = h - 1 - y;
+
+            int lx = x, ly = y;
+
+            if (turns == 1)
+                lx = h - 1 - y, ly = x;
+            else if (turns == 2)
+                lx = w - 1 - x, ly = h - 1 - y;
+            else if (turns == 3)
+                lx = y, ly = w - 1 - x;
+
+            lut[ly * logical_width + lx] = p;
+        }
+
+        width = logical_width;
+        height = turns & 1 ? w : h;
+        return Result<bool, Error>(true);
+    }
+
+    // `table[p]` is the logical index of physical LED p, or LAYOUT_UNMAPPED.
+    // Entries are little-endian u16, as they arrive on the wire.
+    Result<bool, Error> set_table(uint16_t w, uint16_t h, const uint8_t *table, int count)
+    {
+        if (w == 0 || h == 0 || uint32_t(w) * h > L || count > N)
+            return Result<bool, Error>(INVALID_SIZE);
+
+        for (int p = 0; p < count; p++)
+        {
+            const uint16_t logical = load_le(table + p * 2, 2);
+
+            if (logical != LAYOUT_UNMAPPED && logical >= w * h)
+                return Result<bool, Error>(INVALID_TABLE);
+        }
+
+        clear();
+
+        for (int p = 0; p < count; p++)
+        {
+            const uint16_t logical = load_le(table + p * 2, 2);
+
+            if (logical != LAYOUT_UNMAPPED)
+                lut[logical] = p;
+        }
+
+        width = w;
+        height = h;
+        return Result<bool, Error>(true);
+    }
+
+    // Physical index of `logical`; LAYOUT_UNMAPPED (>= N) if there is none.
+    uint16_t physical(int logical) const
+    {
+        return unsigned(logical) < unsigned(L) ? lut[logical] : LAYOUT_UNMAPPED;
+    }
+
+    uint16_t get_width() const { return width; }
+
+    uint16_t get_height() const { return height; }
+};
+
+#endif // LAYOUT_HPP
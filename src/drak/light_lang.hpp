@@ -1,21 +1,549 @@
 #ifndef LIGHT_LANG_HPP
 #define LIGHT_LANG_HPP
 
-#define LED_COUNT 60
+#include <string_view>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "bytes.hpp"
+#include "frame.hpp"
+#include "color.hpp"
+#include "hex.hpp"
+#include "layout.hpp"
+#include "sync.hpp"
+#include "visualizer.hpp"
+#include "governor.hpp"
+#include "anim.hpp"
+#include "metrics.hpp"
+#include "board.hpp"
+#include "strip.hpp"
 
-#include <string>
-#include <cstdlib>
-#include "led_strip.h"
+extern Strip<BoardStrip> strip;
+extern AnimLibrary anim_library;
+extern Metrics metrics;
 
-extern led_strip_handle_t led_strip;
+// Fragment: 'F' + frame id (4 hex) + fragment index (2 hex) + fragment count (2 hex) + records
+// Commit:   'C' + frame id (4 hex)
+// Upload:   'U' + slot (u8) + chunk index (u16 LE) + chunk count (u16 LE) + blob bytes
+// Play:     'P' + slot (u8)
+// Layout:   'L' + width (u16 LE) + height (u16 LE) + flags (u8) [+ logical index (u16 LE) per LED]
+// Beacon:   'T' + sender time in us (u64 LE)
+// Sync:     'S' + mode (u8): 0 presents frames on arrival, 1 stages them until a latch
+// Latch:    'Y' + sender time in us to present at (u64 LE), 0 for now
+// Colour:   'X' + hue shift (u16 LE, 65536 = full turn) + saturation (u16 LE, 256 = 1.0) +
+//           lightness (u16 LE, 256 = 1.0) + tint r g b (u8) + tint amount (u8)
+// Spectrum: 'A' + visualizer (u8) + beat flags (u8) + 1 to 32 band magnitudes (u8), low to high
+constexpr char LL_FRAGMENT = 'F';
+constexpr char LL_COMMIT = 'C';
+constexpr char LL_UPLOAD = 'U';
+constexpr char LL_PLAY = 'P';
+constexpr char LL_LAYOUT = 'L';
+constexpr char LL_BEACON = 'T';
+constexpr char LL_SYNC = 'S';
+constexpr char LL_LATCH = 'Y';
+constexpr char LL_TRANSFORM = 'X';
+constexpr char LL_SPECTRUM = 'A';
+constexpr int LL_RECORD_SIZE = 16;
+constexpr int LL_FRAGMENT_HEADER_SIZE = 9;
+constexpr int LL_COMMIT_SIZE = 5;
+constexpr int LL_UPLOAD_HEADER_SIZE = 6;
+constexpr int LL_PLAY_SIZE = 2;
+constexpr int LL_LAYOUT_HEADER_SIZE = 6;
+constexpr int LL_BEACON_SIZE = 9;
+constexpr int LL_SYNC_SIZE = 2;
+constexpr int LL_LATCH_SIZE = 9;
+constexpr int LL_TRANSFORM_SIZE = 11;
+constexpr int LL_SPECTRUM_HEADER_SIZE = 3;
+constexpr int LL_MAX_OPS = 64;
 
-struct TaskArgs
+enum LightLangResult : uint8_t
 {
-    std::string code;
+    LL_REJECTED,
+    LL_ACCEPTED,
+    LL_JOB,
+    LL_DROPPED
 };
 
+struct LightLangOp
+{
+    uint16_t index;
+    uint8_t r, g, b;
+    uint32_t delay;
+};
+
+// A decoded packet, ready to be rendered without touching the text again.
+struct LightLangJob
+{
+    enum Kind : uint8_t
+    {
+        PROGRAM,
+        FRAME,
+        ANIMATION,
+        LATCH,
+        TRANSFORM,
+        SPECTRUM
+    };
+
+    Kind kind;
+    bool loop;
+    bool staged;
+    uint16_t op_count;
+    LightLangOp ops[LL_MAX_OPS];
+    uint8_t pixels[LED_COUNT * 3];
+    const uint8_t *anim;
+    uint8_t anim_slot;
+    int64_t latch_at;
+    int64_t beacon_sender;
+    int64_t beacon_local;
+    ColorTransform transform;
+    SpectrumFrame spectrum;
+    uint16_t physical[LED_COUNT];
+};
+
+// decode() runs on the receive task and render() on the render task; the
+// frame assembler and the layout are only touched by decode() and the strip
+// only by render(). Indices are remapped to physical LEDs while decoding, so
+// jobs and assembled frames are already in strip order.
 class LightLangCompiler
 {
+private:
+    FrameAssembler<LED_COUNT> assembler;
+    Layout<LED_COUNT> layout;
+    AnimReader pass_reader;
+    SyncClock clock;
+    bool staging = false;
+
+    // Render side: the frame as programs and senders wrote it, and the
+    // colour transform every refresh applies on the way to the strip.
+    uint8_t source[LED_COUNT * 3] = {};
+    uint8_t transformed[LED_COUNT * 3];
+    ColorTransform transform;
+
+    // Spectrum frames are drawn here, per rendered frame, so levels keep
+    // falling after packets stop.
+    Visualizer<LED_COUNT> visualizer;
+    uint8_t visualized[LED_COUNT * 3];
+
+    // A staged frame waits here, apart from `source`, until a latch shows it.
+    uint8_t staged[LED_COUNT * 3];
+    bool staged_valid = false;
+
+    // What is on the strip now; `presented_valid` is false until the first refresh.
+    uint8_t presented[LED_COUNT * 3];
+    bool presented_valid = false;
+    int64_t last_present_us = 0;
+    RefreshGovernor governor;
+
+    // Decodes one 16 digit record; false if any digit is not hex.
+    static bool decode_record(const char *p, LightLangOp &op)
+    {
+        uint8_t n[LL_RECORD_SIZE];
+        const bool valid = hex_decode16(p, n);
+
+        op.index = n[0] << 8 | n[1] << 4 | n[2];
+        op.r = n[3] << 4 | n[4];
+        op.g = n[5] << 4 | n[6];
+        op.b = n[7] << 4 | n[8];
+        op.delay = uint32_t(n[9]) << 24 | n[10] << 20 | n[11] << 16 | n[12] << 12 | n[13] << 8 | n[14] << 4 | n[15];
+
+        return valid;
+    }
+
+    void set_pixel(int index, uint8_t r, uint8_t g, uint8_t b)
+    {
+        if (index < 0 || index >= LED_COUNT)
+            return;
+
+        source[index * 3 + 0] = r;
+        source[index * 3 + 1] = g;
+        source[index * 3 + 2] = b;
+    }
+
+    void transmit(int64_t started)
+    {
+        strip.set_frame(presented);
+        strip.present();
+        last_present_us = started;
+
+        metrics.record_refresh_time(esp_timer_get_time() - started);
+        metrics.record_transmit_time(strip.get_transmit_time_us());
+        metrics.frame_rendered();
+    }
+
+    // Sends the frame unless it matches what the strip already shows; at
+    // this strip length a compare is cheaper than tracking dirty ranges.
+    // Returns true if a new frame went out. An unchanged frame counts once:
+    // as rendered if it went out as a keep-alive, otherwise as skipped.
+    bool refresh(int64_t started = esp_timer_get_time())
+    {
+        const uint8_t *frame = source;
+
+        if (!transform.is_identity())
+        {
+            transform.apply(source, transformed, LED_COUNT);
+            frame = transformed;
+        }
+
+        if (presented_valid && std::memcmp(frame, presented, sizeof(presented)) == 0)
+        {
+            if (!keep_alive())
+                metrics.frame_skipped();
+
+            return false;
+        }
+
+        std::memcpy(presented, frame, sizeof(presented));
+        presented_valid = true;
+        transmit(started);
+        return true;
+    }
+
+    // Ends one pass of a looping program or animation; returns the pause
+    // before the next. One-shot jobs leave the governor alone.
+    uint32_t pass_delay_ms(bool changed)
+    {
+        governor.update(changed);
+        metrics.record_governor_interval(governor.get_interval_us());
+        return governor.get_pass_delay_ms();
+    }
+
+    void take_frame(LightLangJob &job)
+    {
+        job.kind = LightLangJob::FRAME;
+        job.loop = false;
+        job.staged = staging;
+        job.op_count = 0;
+        std::memcpy(job.pixels, assembler.pixels(), sizeof(job.pixels));
+    }
+
+    LightLangResult decode_fragment(std::string_view code, LightLangJob &job)
+    {
+        if (code.length() < LL_FRAGMENT_HEADER_SIZE)
+            return LL_REJECTED;
+
+        uint32_t id, index, count;
+
+        if (!hex_parse(&code[1], 4, id) || !hex_parse(&code[5], 2, index) || !hex_parse(&code[7], 2, count))
+            return LL_REJECTED;
+
+        if (!assembler.begin_fragment(id, index, count))
+            return LL_REJECTED;
+
+        // Delays are meaningless inside an atomically presented frame and are ignored.
+        for (int i = LL_FRAGMENT_HEADER_SIZE; i + LL_RECORD_SIZE <= code.length(); i += LL_RECORD_SIZE)
+        {
+            LightLangOp op;
+
+            if (decode_record(&code[i], op))
+                assembler.set_pixel(layout.physical(op.index), op.r, op.g, op.b);
+        }
+
+        if (!assembler.finish_fragment())
+            return LL_ACCEPTED;
+
+        take_frame(job);
+        return LL_JOB;
+    }
+
+    LightLangResult decode_commit(std::string_view code, LightLangJob &job)
+    {
+        if (code.length() < LL_COMMIT_SIZE)
+            return LL_REJECTED;
+
+        uint32_t id;
+
+        if (!hex_parse(&code[1], 4, id))
+            return LL_REJECTED;
+
+        if (assembler.is_presented(id))
+            return LL_ACCEPTED;
+
+        if (!assembler.commit(id))
+            return LL_REJECTED;
+
+        take_frame(job);
+        return LL_JOB;
+    }
+
+    LightLangResult decode_upload(std::string_view code)
+    {
+        if (code.length() < LL_UPLOAD_HEADER_SIZE)
+            return LL_REJECTED;
+
+        const auto *p = reinterpret_cast<const uint8_t *>(code.data());
+
+        const auto res = anim_library.upload(p[1], load_le(p + 2, 2), load_le(p + 4, 2),
+                                             p + LL_UPLOAD_HEADER_SIZE, code.length() - LL_UPLOAD_HEADER_SIZE);
+        return res.is_ok() ? LL_ACCEPTED : LL_REJECTED;
+    }
+
+    LightLangResult decode_play(std::string_view code, LightLangJob &job)
+    {
+        if (code.length() < LL_PLAY_SIZE)
+            return LL_REJECTED;
+
+        job.kind = LightLangJob::ANIMATION;
+        job.anim_slot = code[1];
+        job.anim = anim_library.find(job.anim_slot);
+
+        if (job.anim == nullptr || !pass_reader.begin(job.anim))
+            return LL_REJECTED;
+
+        // As with programs, the next frame starts from what one full pass
+        // leaves on the strip. Uploads are decoded on this task too, so the
+        // slot can't change underneath the walk.
+        AnimOp op;
+
+        while (pass_reader.next(op))
+            assembler.write_through(op.index, op.r, op.g, op.b);
+
+        return LL_JOB;
+    }
+
+    LightLangResult decode_layout(std::string_view code)
+    {
+        if (code.length() < LL_LAYOUT_HEADER_SIZE)
+            return LL_REJECTED;
+
+        const auto *p = reinterpret_cast<const uint8_t *>(code.data());
+        const uint16_t width = load_le(p + 1, 2);
+        const uint16_t height = load_le(p + 3, 2);
+        const uint8_t flags = p[5];
+
+        const auto res = flags & LAYOUT_TABLE
+                             ? layout.set_table(width, height, p + LL_LAYOUT_HEADER_SIZE,
+                                                (code.length() - LL_LAYOUT_HEADER_SIZE) / 2)
+                             : layout.set_matrix(width, height, flags);
+
+        return res.is_ok() ? LL_ACCEPTED : LL_REJECTED;
+    }
+
+    LightLangResult decode_beacon(std::string_view code)
+    {
+        if (code.length() < LL_BEACON_SIZE)
+            return LL_REJECTED;
+
+        clock.beacon(load_le(reinterpret_cast<const uint8_t *>(&code[1]), 8), esp_timer_get_time());
+        metrics.record_sync_spread(clock.get_spread_us());
+        return LL_ACCEPTED;
+    }
+
+    LightLangResult decode_sync(std::string_view code)
+    {
+        if (code.length() < LL_SYNC_SIZE || uint8_t(code[1]) > 1)
+            return LL_REJECTED;
+
+        staging = code[1] == 1;
+        return LL_ACCEPTED;
+    }
+
+    LightLangResult decode_latch(std::string_view code, LightLangJob &job)
+    {
+        if (code.length() < LL_LATCH_SIZE)
+            return LL_REJECTED;
+
+        const int64_t now = esp_timer_get_time();
+        const int64_t at = load_le(reinterpret_cast<const uint8_t *>(&code[1]), 8);
+
+        job.kind = LightLangJob::LATCH;
+        job.latch_at = at == 0 ? now : clock.to_local(at);
+        job.beacon_sender = clock.get_last_beacon_sender_us();
+        job.beacon_local = clock.get_last_beacon_local_us();
+
+        if (at != 0 && (!clock.is_locked() || job.latch_at - now > SYNC_MAX_LEAD_US))
+            return LL_REJECTED;
+
+        return LL_JOB;
+    }
+
+    // Waits whole ticks while more than one is left, never past the target,
+    // then spins through what remains. A tick wait ends on a tick boundary,
+    // so the spin is always shorter than one tick. Returns false if `wait`
+    // gave up for a newer job.
+    template <typename Wait>
+    static bool sleep_until(int64_t local_us, Wait &wait)
+    {
+        const int64_t tick_us = portTICK_PERIOD_MS * 1000;
+
+        for (int64_t left; (left = local_us - esp_timer_get_time()) > tick_us;)
+            if (!wait(uint32_t((left - 1) / tick_us) * portTICK_PERIOD_MS))
+                return false;
+
+        while (esp_timer_get_time() < local_us)
+        {
+        }
+
+        return true;
+    }
+
+    // Cancelled by a newer latch or a job that shows something now; the
+    // staged frame is then kept for the next latch. Staged jobs queued
+    // behind wait their turn, see preempts().
+    template <typename Wait>
+    void render_latch(const LightLangJob &job, Wait &wait)
+    {
+        if (!sleep_until(job.latch_at, wait))
+            return;
+
+        if (staged_valid)
+        {
+            std::memcpy(source, staged, sizeof(source));
+            staged_valid = false;
+        }
+
+        // A latch that changed nothing sent nothing, and says nothing about
+        // skew. Skew is measured from the last beacon before the latch, which
+        // every controller received too; the offset estimate plays no part.
+        const int64_t started = esp_timer_get_time();
+        if (refresh(started))
+            metrics.record_latch(started - job.latch_at, started - job.beacon_local, job.beacon_sender);
+    }
+
+    LightLangResult decode_transform(std::string_view code, LightLangJob &job)
+    {
+        if (code.length() < LL_TRANSFORM_SIZE)
+            return LL_REJECTED;
+
+        const auto *p = reinterpret_cast<const uint8_t *>(code.data());
+        ColorTransform &t = job.transform;
+
+        job.kind = LightLangJob::TRANSFORM;
+        t.hue_shift = load_le(p + 1, 2) * HSL_HUE_RANGE >> 16;
+        t.saturation = load_le(p + 3, 2);
+        t.lightness = load_le(p + 5, 2);
+        t.tint[0] = p[7];
+        t.tint[1] = p[8];
+        t.tint[2] = p[9];
+        t.tint_amount = p[10];
+        return LL_JOB;
+    }
+
+    // The visualizer runs on the render side; the job carries the layout
+    // as it is now, so its output lands where a frame's would.
+    LightLangResult decode_spectrum(std::string_view code, LightLangJob &job)
+    {
+        const int bands = int(code.length()) - LL_SPECTRUM_HEADER_SIZE;
+
+        if (bands < 1 || bands > SPECTRUM_MAX_BANDS || uint8_t(code[1]) > VIS_PULSE)
+            return LL_REJECTED;
+
+        SpectrumFrame &frame = job.spectrum;
+        frame.mode = code[1];
+        frame.beat = code[2];
+        frame.band_count = bands;
+        std::memcpy(frame.bands, &code[LL_SPECTRUM_HEADER_SIZE], bands);
+
+        job.kind = LightLangJob::SPECTRUM;
+        job.staged = staging;
+
+        for (int i = 0; i < LED_COUNT; i++)
+            job.physical[i] = layout.physical(i);
+
+        return LL_JOB;
+    }
+
+    void draw_spectrum(const LightLangJob &job, uint8_t *frame)
+    {
+        visualizer.draw(visualized);
+        std::memset(frame, 0, LED_COUNT * 3);
+
+        for (int i = 0; i < LED_COUNT; i++)
+            if (job.physical[i] < LED_COUNT)
+                std::memcpy(&frame[job.physical[i] * 3], &visualized[i * 3], 3);
+    }
+
+    // Keeps drawing every VISUALIZER_FRAME_MS until the levels have fallen
+    // to nothing or the next job is queued. A staged frame is drawn once.
+    template <typename Wait>
+    void render_spectrum(const LightLangJob &job, Wait &wait)
+    {
+        visualizer.update(job.spectrum);
+
+        if (job.staged)
+        {
+            draw_spectrum(job, staged);
+            staged_valid = true;
+            return;
+        }
+
+        bool idle;
+
+        do
+        {
+            // The frame drawn once idle is the dark one that ends the fade.
+            idle = visualizer.is_idle();
+            draw_spectrum(job, source);
+            refresh();
+
+        } while (!idle && wait(VISUALIZER_FRAME_MS));
+    }
+
+    LightLangResult decode_program(std::string_view code, LightLangJob &job)
+    {
+        job.kind = LightLangJob::PROGRAM;
+        job.loop = code[0] == '1';
+        job.op_count = 0;
+
+        for (int i = 1; i + LL_RECORD_SIZE <= code.length() && job.op_count < LL_MAX_OPS; i += LL_RECORD_SIZE)
+        {
+            LightLangOp &op = job.ops[job.op_count];
+
+            if (!decode_record(&code[i], op))
+                continue;
+
+            op.index = layout.physical(op.index);
+
+            if (op.index >= LED_COUNT)
+                continue;
+
+            assembler.write_through(op.index, op.r, op.g, op.b);
+            job.op_count++;
+        }
+
+        return LL_JOB;
+    }
+
+    // The slot is held for the whole stream, so an upload can't erase it
+    // underneath the reader.
+    template <typename Wait>
+    void render_animation(const LightLangJob &job, Wait &wait)
+    {
+        if (!anim_library.begin_playback(job.anim_slot))
+            return;
+
+        stream_animation(job, wait);
+        anim_library.end_playback();
+    }
+
+    // Streams ops out of the mapped partition; nothing is copied to RAM.
+    // Stored animations are baked in physical order and bypass the layout.
+    // The header is checked again here, as the slot may have been erased
+    // since the job was decoded.
+    template <typename Wait>
+    void stream_animation(const LightLangJob &job, Wait &wait)
+    {
+        AnimReader reader;
+        AnimOp op;
+        bool changed;
+
+        if (!reader.begin(job.anim))
+            return;
+
+        do
+        {
+            while (reader.next(op))
+            {
+                if (op.delay > 0 && !wait(op.delay))
+                    return;
+
+                set_pixel(op.index, op.r, op.g, op.b);
+            }
+
+            changed = refresh();
+            reader.rewind();
+
+        } while (reader.loop() && wait(pass_delay_ms(changed)));
+    }
+
 public:
     ~LightLangCompiler()
     {
@@ -26,36 +554,138 @@ public:
     {
     }
 
-    void execute(std::string code)
+    const FrameStats &get_frame_stats() const
     {
-        bool loop = false;
+        return assembler.get_stats();
+    }
 
-        do
+    // Receive task only. Gives up on a frame whose fragments stopped arriving.
+    void poll()
+    {
+        assembler.expire(esp_timer_get_time());
+    }
+
+    // Render task only. Re-sends the frame on the strip once it has been
+    // unchanged for REFRESH_KEEPALIVE_US. Returns true if it did.
+    bool keep_alive()
+    {
+        const int64_t now = esp_timer_get_time();
+
+        if (REFRESH_KEEPALIVE_US <= 0 || !presented_valid || now - last_present_us < REFRESH_KEEPALIVE_US)
+            return false;
+
+        transmit(now);
+        return true;
+    }
+
+    // LL_JOB means `job` was filled and must be rendered; LL_ACCEPTED means
+    // the packet was valid but left nothing to render yet, e.g. a fragment of
+    // a frame that is still incomplete.
+    LightLangResult decode(std::string_view code, LightLangJob &job)
+    {
+        if (code.empty())
+            return LL_REJECTED;
+
+        if (code[0] == LL_FRAGMENT)
+            return decode_fragment(code, job);
+
+        if (code[0] == LL_COMMIT)
+            return decode_commit(code, job);
+
+        if (code[0] == LL_UPLOAD)
+            return decode_upload(code);
+
+        if (code[0] == LL_PLAY)
+            return decode_play(code, job);
+
+        if (code[0] == LL_LAYOUT)
+            return decode_layout(code);
+
+        if (code[0] == LL_BEACON)
+            return decode_beacon(code);
+
+        if (code[0] == LL_SYNC)
+            return decode_sync(code);
+
+        if (code[0] == LL_LATCH)
+            return decode_latch(code, job);
+
+        if (code[0] == LL_TRANSFORM)
+            return decode_transform(code, job);
+
+        if (code[0] == LL_SPECTRUM)
+            return decode_spectrum(code, job);
+
+        return decode_program(code, job);
+    }
+
+    // True if `next`, queued behind `current`, should end it. Any job ends a
+    // program, animation or spectrum fade. A pending latch only gives way to
+    // a newer latch or to a job that is not staged; staged frames arriving
+    // in the meantime belong to a later latch and queue behind it.
+    static bool preempts(const LightLangJob &current, const LightLangJob &next)
+    {
+        if (current.kind != LightLangJob::LATCH)
+            return true;
+
+        const bool staged = (next.kind == LightLangJob::FRAME || next.kind == LightLangJob::SPECTRUM) && next.staged;
+        return !staged;
+    }
+
+    // `wait(ms)` sleeps between records and returns false once a job that
+    // preempts() the current one is waiting, which ends it. Looping programs poll it after
+    // every pass with the governor's pause, 0 while the frame keeps changing.
+    template <typename Wait>
+    void render(const LightLangJob &job, Wait &&wait)
+    {
+        if (job.kind == LightLangJob::FRAME && job.staged)
         {
-            loop = code[0] == '1';
+            std::memcpy(staged, job.pixels, sizeof(staged));
+            staged_valid = true;
+            return;
+        }
 
-            for (int i = 1; i + 16 <= code.length(); i += 16)
-            {
-                int led_index = strtol(code.substr(i, 3).c_str(), nullptr, 16);
+        if (job.kind == LightLangJob::FRAME)
+        {
+            std::memcpy(source, job.pixels, sizeof(source));
+            refresh();
+            return;
+        }
+
+        if (job.kind == LightLangJob::TRANSFORM)
+        {
+            transform = job.transform;
+            refresh();
+            return;
+        }
 
-                if (led_index < 0 || led_index >= LED_COUNT)
-                    continue;
+        if (job.kind == LightLangJob::LATCH)
+            return render_latch(job, wait);
 
-                int r = strtol(code.substr(i + 3, 2).c_str(), nullptr, 16);
-                int g = strtol(code.substr(i + 5, 2).c_str(), nullptr, 16);
-                int b = strtol(code.substr(i + 7, 2).c_str(), nullptr, 16);
-                int delay = strtol(code.substr(i + 9, 7).c_str(), nullptr, 16);
+        if (job.kind == LightLangJob::ANIMATION)
+            return render_animation(job, wait);
+
+        if (job.kind == LightLangJob::SPECTRUM)
+            return render_spectrum(job, wait);
+
+        bool changed;
+
+        do
+        {
+            for (int i = 0; i < job.op_count; i++)
+            {
+                const LightLangOp &op = job.ops[i];
 
-                if (delay > 0)
-                    vTaskDelay(pdMS_TO_TICKS(delay));
+                if (op.delay > 0 && !wait(op.delay))
+                    return;
 
-                led_strip_set_pixel(led_strip, led_index, r, g, b);
+                set_pixel(op.index, op.r, op.g, op.b);
             }
 
-            led_strip_refresh(led_strip);
+            changed = refresh();
 
-        } while (loop);
+        } while (job.loop && wait(pass_delay_ms(changed)));
     }
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,321 @@
+#ifndef METRICS_HPP
+#define METRICS_HPP
+
+#include "esp_heap_caps.h"
+#include "esp_http_server.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "esp_wifi.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "frame.hpp"
+#include "result.hpp"
+#include <atomic>
+#include <cinttypes>
+#include <cstdarg>
+#include <cstdio>
+
+constexpr int METRICS_MAX_TASKS = 8;
+constexpr int METRICS_HISTOGRAM_BUCKETS = 24;
+
+// Log2 histogram of durations in microseconds; bucket i counts samples up to 2^i us.
+class LatencyHistogram
+{
+private:
+    std::atomic<uint32_t> buckets[METRICS_HISTOGRAM_BUCKETS] = {};
+
+public:
+    void record(uint32_t us)
+    {
+        int i = us <= 1 ? 0 : 32 - __builtin_clz(us - 1);
+
+        if (i >= METRICS_HISTOGRAM_BUCKETS)
+            i = METRICS_HISTOGRAM_BUCKETS - 1;
+
+        buckets[i].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Upper bound of the bucket holding quantile `q`, 0 if nothing was recorded.
+    uint32_t quantile(float q) const
+    {
+        uint32_t counts[METRICS_HISTOGRAM_BUCKETS];
+        uint32_t total = 0;
+
+        for (int i = 0; i < METRICS_HISTOGRAM_BUCKETS; i++)
+            total += counts[i] = buckets[i].load(std::memory_order_relaxed);
+
+        if (total == 0)
+            return 0;
+
+        const uint32_t rank = q * total;
+        uint32_t seen = 0;
+
+        for (int i = 0; i < METRICS_HISTOGRAM_BUCKETS; i++)
+        {
+            seen += counts[i];
+            if (seen > rank)
+                return uint32_t(1) << i;
+        }
+
+        return uint32_t(1) << (METRICS_HISTOGRAM_BUCKETS - 1);
+    }
+};
+
+// Device health counters, served in Prometheus text format on GET /metrics.
+// Hot paths only do relaxed atomic increments into their own core's slot, so
+// a scrape never takes a lock the receive or render task could wait on.
+class Metrics
+{
+public:
+    enum Error
+    {
+        FAILED_START_SERVER,
+        FAILED_REGISTER_URI
+    };
+
+private:
+    struct alignas(32) CoreCounters
+    {
+        std::atomic<uint32_t> packets_received{0};
+        std::atomic<uint32_t> packets_dropped{0};
+        std::atomic<uint32_t> frames_rendered{0};
+        std::atomic<uint32_t> frames_skipped{0};
+    };
+
+    struct WatchedTask
+    {
+        const char *name;
+        TaskHandle_t handle;
+    };
+
+    CoreCounters cores[portNUM_PROCESSORS];
+
+    LatencyHistogram parse_time;
+    LatencyHistogram refresh_time;
+    LatencyHistogram transmit_time;
+    LatencyHistogram latch_error;
+
+    std::atomic<int64_t> latch_since_beacon_us{0};
+    std::atomic<int64_t> latch_beacon_us{0};
+    std::atomic<uint32_t> sync_spread_us{0};
+    std::atomic<uint32_t> governor_interval_us{0};
+
+    // Exponential moving average of the raw wire time, weight 1/8. Only the
+    // render task writes it.
+    std::atomic<uint32_t> transmit_mean_us{0};
+
+    WatchedTask tasks[METRICS_MAX_TASKS] = {};
+    int task_count = 0;
+
+    const FrameStats *frame_stats = nullptr;
+
+    httpd_handle_t server = nullptr;
+
+    // Only touched by the HTTP server task.
+    uint32_t last_frames = 0;
+    int64_t last_scrape_us = 0;
+    float fps = 0;
+
+    CoreCounters &core() { return cores[xPortGetCoreID()]; }
+
+    static esp_err_t metrics_handler(httpd_req_t *req)
+    {
+        return static_cast<Metrics *>(req->user_ctx)->serve(req);
+    }
+
+    static void emit(httpd_req_t *req, const char *fmt, ...)
+    {
+        char line[160];
+        va_list args;
+
+        va_start(args, fmt);
+        vsnprintf(line, sizeof(line), fmt, args);
+        va_end(args);
+
+        httpd_resp_sendstr_chunk(req, line);
+    }
+
+    void emit_per_core(httpd_req_t *req, const char *name, std::atomic<uint32_t> CoreCounters::*field)
+    {
+        emit(req, "# TYPE %s counter\n", name);
+        for (int c = 0; c < portNUM_PROCESSORS; c++)
+            emit(req, "%s{core=\"%d\"} %" PRIu32 "\n", name, c, (cores[c].*field).load(std::memory_order_relaxed));
+    }
+
+    void emit_quantiles(httpd_req_t *req, const char *name, const LatencyHistogram &h)
+    {
+        emit(req, "# TYPE %s summary\n", name);
+        for (const float q : {0.5f, 0.9f, 0.99f})
+            emit(req, "%s{quantile=\"%g\"} %" PRIu32 "\n", name, q, h.quantile(q));
+    }
+
+    esp_err_t serve(httpd_req_t *req)
+    {
+        httpd_resp_set_type(req, "text/plain; version=0.0.4");
+
+        const uint32_t frames = get_frames_rendered();
+        const int64_t now = esp_timer_get_time();
+
+        if (last_scrape_us != 0 && now > last_scrape_us)
+            fps = (frames - last_frames) * 1e6f / (now - last_scrape_us);
+
+        last_frames = frames;
+        last_scrape_us = now;
+
+        emit_per_core(req, "llc_packets_received_total", &CoreCounters::packets_received);
+        emit_per_core(req, "llc_packets_dropped_total", &CoreCounters::packets_dropped);
+        emit_per_core(req, "llc_frames_rendered_total", &CoreCounters::frames_rendered);
+        emit_per_core(req, "llc_frames_skipped_total", &CoreCounters::frames_skipped);
+
+        emit(req, "# TYPE llc_fps gauge\nllc_fps %.2f\n", fps);
+        emit(req, "# TYPE llc_governor_interval_us gauge\nllc_governor_interval_us %" PRIu32 "\n",
+             governor_interval_us.load(std::memory_order_relaxed));
+
+        emit_quantiles(req, "llc_parse_time_us", parse_time);
+        emit_quantiles(req, "llc_refresh_time_us", refresh_time);
+        emit_quantiles(req, "llc_transmit_time_us", transmit_time);
+        emit_quantiles(req, "llc_sync_latch_error_us", latch_error);
+
+        emit(req, "# TYPE llc_sync_latch_since_beacon_us gauge\nllc_sync_latch_since_beacon_us %" PRId64 "\n",
+             latch_since_beacon_us.load(std::memory_order_relaxed));
+        emit(req, "# TYPE llc_sync_latch_beacon_us gauge\nllc_sync_latch_beacon_us %" PRId64 "\n",
+             latch_beacon_us.load(std::memory_order_relaxed));
+        emit(req, "# TYPE llc_sync_offset_spread_us gauge\nllc_sync_offset_spread_us %" PRIu32 "\n",
+             sync_spread_us.load(std::memory_order_relaxed));
+
+        if (frame_stats != nullptr)
+        {
+            emit(req, "# TYPE llc_frames_completed_total counter\nllc_frames_completed_total %" PRIu32 "\n",
+                 frame_stats->frames_completed.load(std::memory_order_relaxed));
+            emit(req, "# TYPE llc_frames_committed_total counter\nllc_frames_committed_total %" PRIu32 "\n",
+                 frame_stats->frames_committed.load(std::memory_order_relaxed));
+            emit(req, "# TYPE llc_frames_partial_dropped_total counter\nllc_frames_partial_dropped_total %" PRIu32
+                      "\n",
+                 frame_stats->frames_dropped.load(std::memory_order_relaxed));
+            emit(req, "# TYPE llc_fragments_rejected_total counter\nllc_fragments_rejected_total %" PRIu32 "\n",
+                 frame_stats->fragments_rejected.load(std::memory_order_relaxed));
+        }
+
+        emit(req, "# TYPE llc_heap_free_bytes gauge\nllc_heap_free_bytes %" PRIu32 "\n", esp_get_free_heap_size());
+        emit(req, "# TYPE llc_heap_min_free_bytes gauge\nllc_heap_min_free_bytes %" PRIu32 "\n",
+             esp_get_minimum_free_heap_size());
+
+        emit(req, "# TYPE llc_task_stack_free_bytes gauge\n");
+        for (int i = 0; i < task_count; i++)
+            emit(req, "llc_task_stack_free_bytes{task=\"%s\"} %u\n", tasks[i].name,
+                 unsigned(uxTaskGetStackHighWaterMark(tasks[i].handle)));
+
+        wifi_ap_record_t ap;
+        if (esp_wifi_sta_get_ap_info(&ap) == ESP_OK)
+            emit(req, "# TYPE llc_wifi_rssi_dbm gauge\nllc_wifi_rssi_dbm %d\n", ap.rssi);
+
+        return httpd_resp_sendstr_chunk(req, nullptr);
+    }
+
+public:
+    void packet_received() { core().packets_received.fetch_add(1, std::memory_order_relaxed); }
+
+    void packet_dropped() { core().packets_dropped.fetch_add(1, std::memory_order_relaxed); }
+
+    void frame_rendered() { core().frames_rendered.fetch_add(1, std::memory_order_relaxed); }
+
+    void frame_skipped() { core().frames_skipped.fetch_add(1, std::memory_order_relaxed); }
+
+    void record_parse_time(uint32_t us) { parse_time.record(us); }
+
+    void record_refresh_time(uint32_t us) { refresh_time.record(us); }
+
+    void record_transmit_time(uint32_t us)
+    {
+        if (us == 0)
+            return;
+
+        transmit_time.record(us);
+
+        const uint32_t mean = transmit_mean_us.load(std::memory_order_relaxed);
+        transmit_mean_us.store(mean == 0 ? us : mean - mean / 8 + us / 8, std::memory_order_relaxed);
+    }
+
+    // `error_us` is how far the latch missed its target. `since_beacon_us`
+    // is how long after the beacon sent at `beacon_us` (sender's clock) it
+    // went out; controllers that saw the same beacon compare on that.
+    void record_latch(uint32_t error_us, int64_t since_beacon_us, int64_t beacon_us)
+    {
+        latch_error.record(error_us);
+        latch_beacon_us.store(beacon_us, std::memory_order_relaxed);
+        latch_since_beacon_us.store(since_beacon_us, std::memory_order_relaxed);
+    }
+
+    void record_sync_spread(uint32_t us) { sync_spread_us.store(us, std::memory_order_relaxed); }
+
+    void record_governor_interval(uint32_t us) { governor_interval_us.store(us, std::memory_order_relaxed); }
+
+    uint32_t get_frames_rendered() const
+    {
+        uint32_t total = 0;
+        for (const auto &c : cores)
+            total += c.frames_rendered.load(std::memory_order_relaxed);
+        return total;
+    }
+
+    uint32_t get_packets_received() const
+    {
+        uint32_t total = 0;
+        for (const auto &c : cores)
+            total += c.packets_received.load(std::memory_order_relaxed);
+        return total;
+    }
+
+    // 0 until the first frame has been on the wire.
+    uint32_t get_transmit_mean_us() const { return transmit_mean_us.load(std::memory_order_relaxed); }
+
+    uint32_t get_packets_dropped() const
+    {
+        uint32_t total = 0;
+        for (const auto &c : cores)
+            total += c.packets_dropped.load(std::memory_order_relaxed);
+        return total;
+    }
+
+    // Must be called before start().
+    void watch_task(const char *name, TaskHandle_t handle)
+    {
+        if (handle != nullptr && task_count < METRICS_MAX_TASKS)
+            tasks[task_count++] = {name, handle};
+    }
+
+    void watch_frames(const FrameStats *stats) { frame_stats = stats; }
+
+    httpd_handle_t get_http_server() const { return server; }
+
+    Result<bool, Error> start(uint16_t port)
+    {
+        httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+        config.server_port = port;
+        config.core_id = PRO_CPU_NUM;
+        config.task_priority = tskIDLE_PRIORITY + 1;
+
+        if (httpd_start(&server, &config) != ESP_OK)
+            return Result<bool, Error>(FAILED_START_SERVER);
+
+        const httpd_uri_t uri = {
+            .uri = "/metrics",
+            .method = HTTP_GET,
+            .handler = &Metrics::metrics_handler,
+            .user_ctx = this,
+        };
+
+        if (httpd_register_uri_handler(server, &uri) != ESP_OK)
+            return Result<bool, Error>(FAILED_REGISTER_URI);
+
+        return Result<bool, Error>(true);
+    }
+
+    ~Metrics()
+    {
+        if (server != nullptr)
+            httpd_stop(server);
+    }
+};
+
+#endif // METRICS_HPP
@@ -0,0 +1,160 @@
+#ifndef PIPELINE_HPP
+#define PIPELINE_HPP
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "light_lang.hpp"
+#include "metrics.hpp"
+#include "result.hpp"
+#include "ring.hpp"
+#include <string_view>
+
+// Wi-Fi and the UDP receive task live on PRO_CPU; rendering gets APP_CPU to itself.
+constexpr BaseType_t RENDER_CORE = APP_CPU_NUM;
+constexpr size_t PIPELINE_DEPTH = 4;
+constexpr uint32_t RENDER_STACK_SIZE = 4096;
+
+// Joins the receive task (producer) and the render task (consumer) through
+// an SPSC ring of decoded jobs. Packets are decoded straight into ring slots.
+class Pipeline
+{
+public:
+    enum Error
+    {
+        FAILED_START_TASK
+    };
+
+private:
+    LightLangCompiler &llc;
+    SpscRing<LightLangJob, PIPELINE_DEPTH> ring;
+    TaskHandle_t render_handle = nullptr;
+
+    // Packets that arrive while the ring is full are still decoded here so
+    // that the frame assembler sees every fragment.
+    LightLangJob overflow;
+
+    // While idle, the render task still wakes for the strip keep-alive.
+    static constexpr TickType_t idle_timeout =
+        REFRESH_KEEPALIVE_US > 0 ? pdMS_TO_TICKS(REFRESH_KEEPALIVE_US / 1000) : portMAX_DELAY;
+
+    static void render_task(void *arg) { static_cast<Pipeline *>(arg)->render_loop(); }
+
+    // True once a job queued behind the one rendering should end it.
+    bool preempted()
+    {
+        const LightLangJob *current = ring.peek();
+
+        for (size_t i = 1; const LightLangJob *next = ring.peek(i); i++)
+            if (LightLangCompiler::preempts(*current, *next))
+                return true;
+
+        return false;
+    }
+
+    // Sleeps up to `ms`, returning false as soon as a queued job preempts
+    // the current one. Every submit notifies, including ones that landed
+    // while this task was busy, so a wake-up only ends the wait if such a
+    // job is really there; otherwise it sleeps on until the deadline.
+    bool wait(uint32_t ms)
+    {
+        const TickType_t started = xTaskGetTickCount();
+        const TickType_t ticks = pdMS_TO_TICKS(ms);
+
+        while (!preempted())
+        {
+            const TickType_t elapsed = xTaskGetTickCount() - started;
+
+            if (elapsed >= ticks)
+                return true;
+
+            ulTaskNotifyTake(pdTRUE, ticks - elapsed);
+        }
+
+        return false;
+    }
+
+    [[noreturn]] void render_loop()
+    {
+        while (true)
+        {
+            const LightLangJob *job = ring.peek();
+
+            if (job == nullptr)
+            {
+                ulTaskNotifyTake(pdTRUE, idle_timeout);
+                llc.keep_alive();
+                continue;
+            }
+
+            llc.render(*job, [this](uint32_t ms) { return this->wait(ms); });
+            ring.consume();
+        }
+    }
+
+public:
+    explicit Pipeline(LightLangCompiler &compiler) : llc(compiler)
+    {
+    }
+
+    Result<bool, Error> start()
+    {
+        BaseType_t res = xTaskCreatePinnedToCore(render_task, "llc_render", RENDER_STACK_SIZE, this, 5, &render_handle,
+                                                 RENDER_CORE);
+
+        if (res != pdPASS)
+        {
+            return Result<bool, Error>(FAILED_START_TASK);
+        }
+
+        return Result<bool, Error>(true);
+    }
+
+    // Producer side; must only be called from the receive task.
+    // Returns the decode result, or LL_DROPPED if the job did not fit in the ring.
+    LightLangResult submit(std::string_view code)
+    {
+        metrics.packet_received();
+
+        LightLangJob *slot = ring.claim();
+        const bool full = slot == nullptr;
+
+        if (full)
+            slot = &overflow;
+
+        const int64_t started = esp_timer_get_time();
+        const LightLangResult result = llc.decode(code, *slot);
+        metrics.record_parse_time(esp_timer_get_time() - started);
+
+        if (result != LL_JOB)
+            return result;
+
+        if (full)
+        {
+            metrics.packet_dropped();
+            return LL_DROPPED;
+        }
+
+        ring.publish();
+
+        if (render_handle != nullptr)
+            xTaskNotifyGive(render_handle);
+
+        return LL_JOB;
+    }
+
+    size_t get_queue_depth() const { return ring.size(); }
+
+    static constexpr size_t get_queue_capacity() { return PIPELINE_DEPTH; }
+
+    TaskHandle_t get_task_handle() const { return render_handle; }
+
+    ~Pipeline()
+    {
+        if (render_handle != nullptr)
+        {
+            vTaskDelete(render_handle);
+        }
+    }
+};
+
+#endif // PIPELINE_HPP
@@ -0,0 +1,92 @@
+#ifndef RING_HPP
+#define RING_HPP
+
+#include <atomic>
+#include <cstddef>
+
+constexpr size_t RING_ALIGN = 64;
+
+// Lock-free single-producer/single-consumer ring. Only the standard library
+// is used, so the same code runs between FreeRTOS tasks and host threads.
+//
+// Slots are filled and drained in place: the producer claims a slot, writes
+// it and publishes; the consumer peeks, uses the slot and consumes it.
+template <typename T, size_t N>
+class SpscRing
+{
+    static_assert(N > 0 && (N & (N - 1)) == 0, "ring size must be a power of two");
+
+private:
+    T slots[N];
+
+    alignas(RING_ALIGN) std::atomic<size_t> head{0};
+    alignas(RING_ALIGN) std::atomic<size_t> tail{0};
+
+public:
+    // Producer side. Returns nullptr when the ring is full.
+    T *claim()
+    {
+        const size_t h = head.load(std::memory_order_relaxed);
+
+        if (h - tail.load(std::memory_order_acquire) == N)
+            return nullptr;
+
+        return &slots[h & (N - 1)];
+    }
+
+    void publish()
+    {
+        head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // Consumer side. Returns the `i`th queued item, the front one by
+    // default, or nullptr when fewer are queued.
+    T *peek(size_t i = 0)
+    {
+        const size_t t = tail.load(std::memory_order_relaxed);
+
+        if (head.load(std::memory_order_acquire) - t <= i)
+            return nullptr;
+
+        return &slots[(t + i) & (N - 1)];
+    }
+
+    void consume()
+    {
+        tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    bool push(const T &value)
+    {
+        T *slot = claim();
+
+        if (slot == nullptr)
+            return false;
+
+        *slot = value;
+        publish();
+        return true;
+    }
+
+    bool pop(T &out)
+    {
+        T *slot = peek();
+
+        if (slot == nullptr)
+            return false;
+
+        out = *slot;
+        consume();
+        return true;
+    }
+
+    size_t size() const
+    {
+        const size_t t = tail.load(std::memory_order_acquire);
+        return head.load(std::memory_order_acquire) - t;
+    }
+
+    static constexpr size_t capacity() { return N; }
+};
+
+#endif // RING_HPP
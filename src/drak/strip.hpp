@@ -0,0 +1,265 @@
+#ifndef STRIP_HPP
+#define STRIP_HPP
+
+#include "driver/rmt_encoder.h"
+#include "driver/rmt_tx.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "result.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+constexpr uint32_t STRIP_RESOLUTION_HZ = 10 * 1000 * 1000;
+
+// LED models: bit timings in 0.1 us ticks and the reset (latch) time.
+struct SK6812
+{
+    static constexpr uint16_t t0h = 3, t0l = 9, t1h = 6, t1l = 6;
+    static constexpr int64_t reset_us = 80;
+};
+
+struct WS2812
+{
+    static constexpr uint16_t t0h = 4, t0l = 8, t1h = 8, t1l = 4;
+    static constexpr int64_t reset_us = 280;
+};
+
+// Colour orders: the wire offset of each channel within a pixel, -1 if absent.
+namespace ColorOrder
+{
+    struct RGB
+    {
+        static constexpr int channels = 3, r = 0, g = 1, b = 2, w = -1;
+    };
+
+    struct GRB
+    {
+        static constexpr int channels = 3, r = 1, g = 0, b = 2, w = -1;
+    };
+
+    struct RGBW
+    {
+        static constexpr int channels = 4, r = 0, g = 1, b = 2, w = 3;
+    };
+
+    struct GRBW
+    {
+        static constexpr int channels = 4, r = 1, g = 0, b = 2, w = 3;
+    };
+}
+
+// Compile-time description of an attached strip.
+template <typename Model, typename Order, int Count, int Gpio>
+struct StripConfig
+{
+    using model = Model;
+    using order = Order;
+
+    static constexpr int count = Count;
+    static constexpr int gpio = Gpio;
+    static constexpr int channels = Order::channels;
+    static constexpr size_t frame_bytes = size_t(Count) * Order::channels;
+
+    // Time on the wire for one frame, without the reset gap.
+    static constexpr uint32_t frame_wire_us = frame_bytes * 8 * (Model::t0h + Model::t0l) / 10;
+
+    static_assert(Count > 0 && Count <= 4096, "LED count must fit the 3 hex digit record index");
+    static_assert(Gpio >= 0 && Gpio < 49, "not an ESP32-S3 GPIO");
+    static_assert(Order::channels == 3 || Order::channels == 4, "unsupported colour order");
+    static_assert(Model::t0h + Model::t0l == Model::t1h + Model::t1l, "bit periods must match");
+};
+
+template <typename Config>
+class Strip
+{
+public:
+    enum Error
+    {
+        FAILED_CREATE_CHANNEL,
+        FAILED_CREATE_ENCODER,
+        FAILED_REGISTER_CALLBACK,
+        FAILED_ENABLE_CHANNEL
+    };
+
+private:
+    rmt_channel_handle_t channel = nullptr;
+    rmt_encoder_handle_t encoder = nullptr;
+    SemaphoreHandle_t done = nullptr;
+
+    using Order = typename Config::order;
+    using Model = typename Config::model;
+
+    static constexpr int N = Config::count;
+    static constexpr int C = Config::channels;
+
+    uint8_t buffers[2][Config::frame_bytes] = {};
+    int back = 0;
+
+    bool in_flight = false;
+    int64_t started_at = 0;
+    volatile int64_t done_at = 0;
+    uint32_t transmit_time_us = 0;
+
+    static bool on_trans_done(rmt_channel_handle_t, const rmt_tx_done_event_data_t *, void *ctx)
+    {
+        auto *self = static_cast<Strip *>(ctx);
+        BaseType_t woken = pdFALSE;
+
+        self->done_at = esp_timer_get_time();
+        xSemaphoreGiveFromISR(self->done, &woken);
+        return woken == pdTRUE;
+    }
+
+    // RGBW strips get the common part of r, g and b on the white channel.
+    static void pack(uint8_t *p, uint8_t r, uint8_t g, uint8_t b)
+    {
+        if constexpr (Order::w >= 0)
+        {
+            const uint8_t w = std::min(r, std::min(g, b));
+            p[Order::r] = r - w;
+            p[Order::g] = g - w;
+            p[Order::b] = b - w;
+            p[Order::w] = w;
+        }
+        else
+        {
+            p[Order::r] = r;
+            p[Order::g] = g;
+            p[Order::b] = b;
+        }
+    }
+
+    void wait_done()
+    {
+        if (!in_flight)
+            return;
+
+        xSemaphoreTake(done, portMAX_DELAY);
+        in_flight = false;
+        transmit_time_us = done_at - started_at;
+
+        // The line has to idle low for the reset time before the next frame.
+        while (esp_timer_get_time() - done_at < Model::reset_us)
+        {
+        }
+    }
+
+public:
+    Result<bool, Error> init()
+    {
+        done = xSemaphoreCreateBinary();
+
+        const rmt_tx_channel_config_t channel_config = {
+            .gpio_num = static_cast<gpio_num_t>(Config::gpio),
+            .clk_src = RMT_CLK_SRC_DEFAULT,
+            .resolution_hz = STRIP_RESOLUTION_HZ,
+            .mem_block_symbols = 64,
+            .trans_queue_depth = 2,
+            .flags = {
+                .invert_out = false,
+                .with_dma = false,
+            }};
+
+        if (rmt_new_tx_channel(&channel_config, &channel) != ESP_OK)
+            return Result<bool, Error>(FAILED_CREATE_CHANNEL);
+
+        rmt_bytes_encoder_config_t encoder_config = {};
+        encoder_config.bit0.duration0 = Model::t0h;
+        encoder_config.bit0.level0 = 1;
+        encoder_config.bit0.duration1 = Model::t0l;
+        encoder_config.bit0.level1 = 0;
+        encoder_config.bit1.duration0 = Model::t1h;
+        encoder_config.bit1.level0 = 1;
+        encoder_config.bit1.duration1 = Model::t1l;
+        encoder_config.bit1.level1 = 0;
+        encoder_config.flags.msb_first = 1;
+
+        if (rmt_new_bytes_encoder(&encoder_config, &encoder) != ESP_OK)
+            return Result<bool, Error>(FAILED_CREATE_ENCODER);
+
+        const rmt_tx_event_callbacks_t callbacks = {
+            .on_trans_done = &Strip::on_trans_done,
+        };
+
+        if (rmt_tx_register_event_callbacks(channel, &callbacks, this) != ESP_OK)
+            return Result<bool, Error>(FAILED_REGISTER_CALLBACK);
+
+        if (rmt_enable(channel) != ESP_OK)
+            return Result<bool, Error>(FAILED_ENABLE_CHANNEL);
+
+        return Result<bool, Error>(true);
+    }
+
+    void set_pixel(int index, uint8_t r, uint8_t g, uint8_t b)
+    {
+        if (index < 0 || index >= N)
+            return;
+
+        pack(buffers[back] + index * C, r, g, b);
+    }
+
+    // Packs a whole RGB frame of N pixels into the back buffer.
+    void set_frame(const uint8_t *rgb)
+    {
+        uint8_t *p = buffers[back];
+
+        for (int i = 0; i < N; i++, p += C, rgb += 3)
+            pack(p, rgb[0], rgb[1], rgb[2]);
+    }
+
+    // Starts clocking out the back buffer and flips. The new back buffer
+    // starts as a copy of the frame just sent, so programs that only touch a
+    // few LEDs keep the rest.
+    void present()
+    {
+        wait_done();
+
+        const uint8_t *front = buffers[back];
+        const rmt_transmit_config_t transmit_config = {
+            .loop_count = 0,
+        };
+
+        started_at = esp_timer_get_time();
+        in_flight = rmt_transmit(channel, encoder, front, sizeof(buffers[back]), &transmit_config) == ESP_OK;
+
+        back ^= 1;
+        std::memcpy(buffers[back], front, sizeof(buffers[back]));
+    }
+
+    // Colour of `index` in the last presented frame. Meant for diagnostics;
+    // it is not synchronised with present().
+    void get_pixel(int index, uint8_t &r, uint8_t &g, uint8_t &b) const
+    {
+        const uint8_t *p = buffers[back ^ 1] + index * C;
+        uint8_t w = 0;
+
+        if constexpr (Order::w >= 0)
+            w = p[Order::w];
+
+        r = p[Order::r] + w;
+        g = p[Order::g] + w;
+        b = p[Order::b] + w;
+    }
+
+    // Wire time of the last completed transmission.
+    uint32_t get_transmit_time_us() const { return transmit_time_us; }
+
+    ~Strip()
+    {
+        wait_done();
+
+        if (channel != nullptr)
+        {
+            rmt_disable(channel);
+            rmt_del_channel(channel);
+        }
+        if (encoder != nullptr)
+            rmt_del_encoder(encoder);
+        if (done != nullptr)
+            vSemaphoreDelete(done);
+    }
+};
+
+#endif // STRIP_HPP
@@ -0,0 +1,72 @@
+#ifndef SYNC_HPP
+#define SYNC_HPP
+
+#include <cstdint>
+
+constexpr int SYNC_WINDOW = 8;
+constexpr int64_t SYNC_MAX_LEAD_US = 2 * 1000 * 1000;
+
+// Follows the sender's clock from its 'T' beacons.
+//
+// Each beacon gives local receive time minus sender send time, which is the
+// clock offset plus the network delay. Delay only ever adds, so the smallest
+// sample of the last SYNC_WINDOW beacons is the offset plus the best-case
+// delay; since every controller on the same network sees roughly the same
+// best case, it cancels out between them. The spread of the window bounds
+// how much the estimate can be off.
+//
+// The last beacon is also kept as it arrived. A broadcast beacon reaches all
+// controllers at nearly the same moment, so times measured from it compare
+// across controllers without going through any of their estimates.
+class SyncClock
+{
+private:
+    int64_t samples[SYNC_WINDOW] = {};
+    int count = 0;
+    int next = 0;
+
+    int64_t offset = 0;
+    uint32_t spread = 0;
+
+    int64_t last_sender_us = 0;
+    int64_t last_local_us = 0;
+
+public:
+    void beacon(int64_t sender_us, int64_t local_us)
+    {
+        last_sender_us = sender_us;
+        last_local_us = local_us;
+
+        samples[next] = local_us - sender_us;
+        next = (next + 1) % SYNC_WINDOW;
+
+        if (count < SYNC_WINDOW)
+            count++;
+
+        int64_t lo = samples[0], hi = samples[0];
+
+        for (int i = 1; i < count; i++)
+        {
+            lo = samples[i] < lo ? samples[i] : lo;
+            hi = samples[i] > hi ? samples[i] : hi;
+        }
+
+        offset = lo;
+        spread = hi - lo;
+    }
+
+    bool is_locked() const { return count > 0; }
+
+    int64_t to_local(int64_t sender_us) const { return sender_us + offset; }
+
+    int64_t to_sender(int64_t local_us) const { return local_us - offset; }
+
+    uint32_t get_spread_us() const { return spread; }
+
+    // Sender time of the last beacon, and when it arrived on the local clock.
+    int64_t get_last_beacon_sender_us() const { return last_sender_us; }
+
+    int64_t get_last_beacon_local_us() const { return last_local_us; }
+};
+
+#endif // SYNC_HPP
@@ -9,18 +9,23 @@
 #include "lwip/err.h"
 #include "lwip/sockets.h"
 #include "lwip/sys.h"
+#include "capture.hpp"
 #include "result.hpp"
 #include <algorithm>
-#include <list>
-#include <string>
+#include <cerrno>
 #include <cstring>
+#include <string_view>
 
 namespace UDP
 {
   class Server;
 
   constexpr int MAX_EVENT_HANDLER_COUNT = 20;
+  constexpr int MAX_ENDPOINTS = 4;
   constexpr int RX_BUFFER_SIZE = 1024;
+  constexpr uint32_t TASK_STACK_SIZE = 4096;
+  constexpr int POLL_INTERVAL_MS = 50;
+  constexpr BaseType_t PROTOCOL_CORE = PRO_CPU_NUM;
 
   enum Error
   {
@@ -29,53 +34,170 @@ namespace UDP
     FAILED_START_TASK,
     LISTENER_ALREADY_PRESENT,
     TOO_MANY_LISTENERS,
-    EVENT_SOCKET_ERROR
+    EVENT_SOCKET_ERROR,
+    TOO_MANY_ENDPOINTS,
+    ALREADY_STARTED,
+    FAILED_JOIN_GROUP,
+    INVALID_ENDPOINT
   };
 
   using namespace std;
 
   using handler_error = void (*)(const Server *, Error);
-  using handler_message = void (*)(Server *, const string &data, const string &sender_ip, uint16_t sender_port);
-
+  // Runs on the receive task after every wakeup, and at least every
+  // POLL_INTERVAL_MS while no datagrams arrive.
+  using handler_poll = void (*)(Server *);
+  // `endpoint` is the index of the endpoint the datagram arrived on; replies
+  // should go out through it. `data` and `sender_ip` point into the receive
+  // buffer and are only valid for the duration of the call.
+  using handler_message = void (*)(Server *, int endpoint, string_view data, const char *sender_ip,
+                                   uint16_t sender_port);
+
+  // One task serves every endpoint (a bound port, optionally joined to a
+  // multicast group) through select(). Once woken, it always takes the next
+  // datagram from the highest priority endpoint that has one, so control
+  // traffic never waits behind a backlog of datagrams in the socket buffers.
+  // Priority stops there: whatever the handlers queue afterwards, e.g. render
+  // jobs, is served in arrival order.
   class Server
   {
   private:
-    int sock = -1;
-    int port;
+    struct Endpoint
+    {
+      uint16_t port;
+      int priority;
+      in_addr_t group;
+      int sock;
+      handler_message on_message_handlers[MAX_EVENT_HANDLER_COUNT];
+      int handler_count;
+    };
+
+    Endpoint endpoints[MAX_ENDPOINTS];
+    int endpoint_count = 0;
+    int by_priority[MAX_ENDPOINTS];
+
     TaskHandle_t thread_handle = nullptr;
     volatile bool is_running = false;
 
     SemaphoreHandle_t handler_mutex;
+    Capture capture;
+
+    handler_error on_error_handlers[MAX_EVENT_HANDLER_COUNT] = {};
+    int error_handler_count = 0;
 
-    std::list<handler_error> on_error_handlers;
-    std::list<handler_message> on_message_handlers;
+    handler_poll on_poll_handlers[MAX_EVENT_HANDLER_COUNT] = {};
+    int poll_handler_count = 0;
 
     static void udp_task(void *arg) { static_cast<Server *>(arg)->receiver_loop(); }
 
-    [[noreturn]] void receiver_loop()
+    void close_all()
     {
-      char rx_buffer[RX_BUFFER_SIZE];
-      struct sockaddr_in dest_addr;
+      for (int i = 0; i < endpoint_count; i++)
+      {
+        if (endpoints[i].sock != -1)
+        {
+          shutdown(endpoints[i].sock, 0);
+          close(endpoints[i].sock);
+          endpoints[i].sock = -1;
+        }
+      }
+    }
 
+    bool open_endpoint(Endpoint &e)
+    {
+      struct sockaddr_in dest_addr;
       dest_addr.sin_addr.s_addr = htonl(INADDR_ANY);
       dest_addr.sin_family = AF_INET;
-      dest_addr.sin_port = htons(this->port);
+      dest_addr.sin_port = htons(e.port);
 
-      while (true)
+      e.sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+      if (e.sock < 0)
       {
-        sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
-        if (sock < 0)
+        this->emit_error_event(FAILED_CREATE_SOCKET);
+        return false;
+      }
+
+      int err = bind(e.sock, (struct sockaddr *)&dest_addr, sizeof(dest_addr));
+      if (err < 0)
+      {
+        this->emit_error_event(FAILED_BIND_SOCKET);
+        return false;
+      }
+
+      if (e.group != htonl(INADDR_ANY))
+      {
+        struct ip_mreq mreq;
+        mreq.imr_multiaddr.s_addr = e.group;
+        mreq.imr_interface.s_addr = htonl(INADDR_ANY);
+
+        if (setsockopt(e.sock, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0)
         {
-          this->emit_error_event(FAILED_CREATE_SOCKET);
-          vTaskDelay(pdMS_TO_TICKS(1000));
-          continue;
+          this->emit_error_event(FAILED_JOIN_GROUP);
+          return false;
+        }
+      }
+
+      return true;
+    }
+
+    bool open_all()
+    {
+      for (int i = 0; i < endpoint_count; i++)
+      {
+        if (!open_endpoint(endpoints[i]))
+        {
+          close_all();
+          return false;
         }
+      }
+      return true;
+    }
+
+    // Receives and dispatches one datagram from the highest priority endpoint
+    // that has one waiting. Returns 1 if one was served, 0 if none was
+    // waiting and -1 if a socket failed.
+    int serve_next(char *rx_buffer)
+    {
+      for (int i = 0; i < endpoint_count; i++)
+      {
+        Endpoint &e = endpoints[by_priority[i]];
+        struct sockaddr_storage source_addr;
+        socklen_t socklen = sizeof(source_addr);
+
+        int len = recvfrom(e.sock, rx_buffer, RX_BUFFER_SIZE - 1, MSG_DONTWAIT, (struct sockaddr *)&source_addr,
+                           &socklen);
+
+        if (len < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+          continue;
+
+        if (len < 0)
+          return -1;
+
+        rx_buffer[len] = 0;
+
+        // Captures only cover the primary endpoint, which is what gets replayed.
+        if (&e == &endpoints[0])
+          capture.record(*(struct sockaddr_in *)&source_addr, rx_buffer, len);
+
+        char addr_str[16];
+        inet_ntoa_r(((struct sockaddr_in *)&source_addr)->sin_addr, addr_str, sizeof(addr_str));
+        uint16_t port = ntohs(((struct sockaddr_in *)&source_addr)->sin_port);
+
+        this->emit_message_event(by_priority[i], string_view(rx_buffer, len), addr_str, port);
+        return 1;
+      }
+
+      return 0;
+    }
+
+    [[noreturn]] void receiver_loop()
+    {
+      char rx_buffer[RX_BUFFER_SIZE];
 
-        int err = bind(sock, (struct sockaddr *)&dest_addr, sizeof(dest_addr));
-        if (err < 0)
+      while (true)
+      {
+        if (!open_all())
         {
-          this->emit_error_event(FAILED_BIND_SOCKET);
-          close(sock);
           vTaskDelay(pdMS_TO_TICKS(1000));
           continue;
         }
@@ -84,64 +206,103 @@ namespace UDP
 
         while (is_running)
         {
-          struct sockaddr_storage source_addr;
-          socklen_t socklen = sizeof(source_addr);
+          fd_set readable;
+          int max_fd = -1;
+
+          FD_ZERO(&readable);
+          for (int i = 0; i < endpoint_count; i++)
+          {
+            FD_SET(endpoints[i].sock, &readable);
+            max_fd = std::max(max_fd, endpoints[i].sock);
+          }
+
+          struct timeval timeout = {0, POLL_INTERVAL_MS * 1000};
+          int served = select(max_fd + 1, &readable, nullptr, nullptr, &timeout);
+
+          while (served > 0)
+            served = serve_next(rx_buffer);
 
-          int len = recvfrom(sock, rx_buffer, sizeof(rx_buffer) - 1, 0, (struct sockaddr *)&source_addr, &socklen);
+          this->emit_poll_event();
 
-          if (len < 0)
+          if (served < 0)
           {
             this->emit_error_event(EVENT_SOCKET_ERROR);
             break;
           }
-          else
-          {
-            rx_buffer[len] = 0;
-            string msg(rx_buffer);
-            char addr_str[128];
-            inet_ntoa_r(((struct sockaddr_in *)&source_addr)->sin_addr, addr_str, sizeof(addr_str) - 1);
-            uint16_t port = ntohs(((struct sockaddr_in *)&source_addr)->sin_port);
-
-            this->emit_message_event(msg, string(addr_str), port);
-          }
         }
 
-        if (sock != -1)
-        {
-          shutdown(sock, 0);
-          close(sock);
-          sock = -1;
-        }
+        close_all();
       }
     }
 
     void emit_error_event(const Error e)
     {
       xSemaphoreTake(handler_mutex, portMAX_DELAY);
-      for (const auto &fn : this->on_error_handlers)
-        if (fn)
-          fn(this, e);
+      for (int i = 0; i < error_handler_count; i++)
+        if (on_error_handlers[i])
+          on_error_handlers[i](this, e);
       xSemaphoreGive(handler_mutex);
     }
 
-    void emit_message_event(const string &msg, const string &ip, uint16_t port)
+    void emit_poll_event()
     {
       xSemaphoreTake(handler_mutex, portMAX_DELAY);
-      for (const auto &fn : this->on_message_handlers)
-        if (fn)
-          fn(this, msg, ip, port);
+      for (int i = 0; i < poll_handler_count; i++)
+        if (on_poll_handlers[i])
+          on_poll_handlers[i](this);
+      xSemaphoreGive(handler_mutex);
+    }
+
+    void emit_message_event(int endpoint, string_view msg, const char *ip, uint16_t port)
+    {
+      const Endpoint &e = endpoints[endpoint];
+
+      xSemaphoreTake(handler_mutex, portMAX_DELAY);
+      for (int i = 0; i < e.handler_count; i++)
+        if (e.on_message_handlers[i])
+          e.on_message_handlers[i](this, endpoint, msg, ip, port);
       xSemaphoreGive(handler_mutex);
     }
 
   public:
-    explicit Server(int port_num) : port(port_num)
+    // `port_num` becomes the primary endpoint, 0.
+    explicit Server(int port_num)
     {
       handler_mutex = xSemaphoreCreateMutex();
+      add_endpoint(port_num);
+    }
+
+    // Adds an endpoint served by the same task; higher `priority` is served
+    // first. `group`, if given, is a multicast group to join. Returns the
+    // endpoint index. Endpoints must be added before start().
+    Result<int, Error> add_endpoint(uint16_t port_num, int priority = 0, const char *group = nullptr)
+    {
+      if (thread_handle != nullptr)
+        return Result<int, Error>(ALREADY_STARTED);
+
+      if (endpoint_count >= MAX_ENDPOINTS)
+        return Result<int, Error>(TOO_MANY_ENDPOINTS);
+
+      const int index = endpoint_count++;
+      Endpoint &e = endpoints[index];
+      e.port = port_num;
+      e.priority = priority;
+      e.group = group != nullptr ? inet_addr(group) : htonl(INADDR_ANY);
+      e.sock = -1;
+      e.handler_count = 0;
+
+      // Insertion into the priority order; equal priorities keep insertion order.
+      int i = index;
+      for (; i > 0 && endpoints[by_priority[i - 1]].priority < priority; i--)
+        by_priority[i] = by_priority[i - 1];
+      by_priority[i] = index;
+
+      return Result<int, Error>(index);
     }
 
     Result<bool, Error> start()
     {
-      BaseType_t res = xTaskCreate(udp_task, "udp_server", 4096, this, 5, &thread_handle);
+      BaseType_t res = xTaskCreatePinnedToCore(udp_task, "udp_server", TASK_STACK_SIZE, this, 5, &thread_handle, PROTOCOL_CORE);
 
       if (res != pdPASS)
       {
@@ -151,13 +312,28 @@ namespace UDP
       return Result<bool, Error>(true);
     }
 
-    bool send_to(const string &ip, uint16_t port, const uint8_t *data, size_t len)
+    TaskHandle_t get_task_handle() const { return thread_handle; }
+
+    Capture &get_capture() { return capture; }
+
+    bool send_to(const char *ip, uint16_t port, const uint8_t *data, size_t len)
+    {
+      return send_to(0, ip, port, data, len);
+    }
+
+    // Sends from the given endpoint's socket, so replies come from the port
+    // the request went to.
+    bool send_to(int endpoint, const char *ip, uint16_t port, const uint8_t *data, size_t len)
     {
+      if (endpoint < 0 || endpoint >= endpoint_count)
+        return false;
+
+      const int sock = endpoints[endpoint].sock;
       if (sock < 0)
         return false;
 
       struct sockaddr_in dest_addr;
-      dest_addr.sin_addr.s_addr = inet_addr(ip.c_str());
+      dest_addr.sin_addr.s_addr = inet_addr(ip);
       dest_addr.sin_family = AF_INET;
       dest_addr.sin_port = htons(port);
 
@@ -168,15 +344,14 @@ namespace UDP
     Result<bool, Error> add_on_error_listener(const handler_error listener)
     {
       xSemaphoreTake(handler_mutex, portMAX_DELAY);
-      if (this->on_error_handlers.size() >= MAX_EVENT_HANDLER_COUNT)
+      if (error_handler_count >= MAX_EVENT_HANDLER_COUNT)
       {
         xSemaphoreGive(handler_mutex);
         return Result<bool, Error>(TOO_MANY_LISTENERS);
       }
 
-      const bool listener_present =
-          ranges::find(this->on_error_handlers, listener) !=
-          this->on_error_handlers.end();
+      auto *handlers_end = on_error_handlers + error_handler_count;
+      const bool listener_present = std::find(on_error_handlers, handlers_end, listener) != handlers_end;
 
       if (listener_present)
       {
@@ -184,23 +359,55 @@ namespace UDP
         return Result<bool, Error>(LISTENER_ALREADY_PRESENT);
       }
 
-      this->on_error_handlers.push_back(listener);
+      on_error_handlers[error_handler_count++] = listener;
+      xSemaphoreGive(handler_mutex);
+      return Result<bool, Error>(true);
+    }
+
+    Result<bool, Error> add_on_poll_listener(const handler_poll listener)
+    {
+      xSemaphoreTake(handler_mutex, portMAX_DELAY);
+      if (poll_handler_count >= MAX_EVENT_HANDLER_COUNT)
+      {
+        xSemaphoreGive(handler_mutex);
+        return Result<bool, Error>(TOO_MANY_LISTENERS);
+      }
+
+      auto *handlers_end = on_poll_handlers + poll_handler_count;
+      const bool listener_present = std::find(on_poll_handlers, handlers_end, listener) != handlers_end;
+
+      if (listener_present)
+      {
+        xSemaphoreGive(handler_mutex);
+        return Result<bool, Error>(LISTENER_ALREADY_PRESENT);
+      }
+
+      on_poll_handlers[poll_handler_count++] = listener;
       xSemaphoreGive(handler_mutex);
       return Result<bool, Error>(true);
     }
 
     Result<bool, Error> add_on_message_listener(const handler_message listener)
     {
+      return add_on_message_listener(0, listener);
+    }
+
+    Result<bool, Error> add_on_message_listener(int endpoint, const handler_message listener)
+    {
+      if (endpoint < 0 || endpoint >= endpoint_count)
+        return Result<bool, Error>(INVALID_ENDPOINT);
+
+      Endpoint &e = endpoints[endpoint];
+
       xSemaphoreTake(handler_mutex, portMAX_DELAY);
-      if (this->on_message_handlers.size() >= MAX_EVENT_HANDLER_COUNT)
+      if (e.handler_count >= MAX_EVENT_HANDLER_COUNT)
       {
         xSemaphoreGive(handler_mutex);
         return Result<bool, Error>(TOO_MANY_LISTENERS);
       }
 
-      const bool listener_present =
-          ranges::find(this->on_message_handlers, listener) !=
-          this->on_message_handlers.end();
+      auto *handlers_end = e.on_message_handlers + e.handler_count;
+      const bool listener_present = std::find(e.on_message_handlers, handlers_end, listener) != handlers_end;
 
       if (listener_present)
       {
@@ -208,7 +415,7 @@ namespace UDP
         return Result<bool, Error>(LISTENER_ALREADY_PRESENT);
       }
 
-      this->on_message_handlers.push_back(listener);
+      e.on_message_handlers[e.handler_count++] = listener;
       xSemaphoreGive(handler_mutex);
       return Result<bool, Error>(true);
     }
@@ -216,18 +423,12 @@ namespace UDP
     ~Server()
     {
       is_running = false;
-      if (sock != -1)
-      {
-        shutdown(sock, 0);
-        close(sock);
-      }
+      close_all();
       if (thread_handle != nullptr)
       {
         vTaskDelete(thread_handle);
       }
       vSemaphoreDelete(handler_mutex);
-      on_error_handlers.clear();
-      on_message_handlers.clear();
     }
   };
 }
@@ -0,0 +1,164 @@
+#ifndef VISUALIZER_HPP
+#define VISUALIZER_HPP
+
+#include "color.hpp"
+#include <cstdint>
+#include <cstring>
+
+constexpr int SPECTRUM_MAX_BANDS = 32;
+constexpr uint8_t SPECTRUM_BEAT = 0x01;
+constexpr uint8_t VISUALIZER_RELEASE = 12; // level lost per frame after a peak
+constexpr uint8_t VISUALIZER_FLASH_RELEASE = 32;
+constexpr uint32_t VISUALIZER_FRAME_MS = 20; // decay frames keep coming at this pace
+
+enum VisualizerMode : uint8_t
+{
+    VIS_BARS,   // bands spread along the strip, low to high
+    VIS_CENTER, // bands mirrored out from the middle
+    VIS_PULSE   // whole strip in the loudest band's colour
+};
+
+// One audio analysis frame: band magnitudes, low to high, and beat flags.
+struct SpectrumFrame
+{
+    uint8_t mode;
+    uint8_t beat;
+    uint8_t band_count;
+    uint8_t bands[SPECTRUM_MAX_BANDS];
+};
+
+// Maps spectrum frames to LED colours. update() raises levels at once to a
+// new frame's magnitudes; every draw() then lets them fall by
+// VISUALIZER_RELEASE, so short peaks stay visible and the strip fades out
+// once frames stop. A beat flashes the strip white in every mode.
+template <int N>
+class Visualizer
+{
+private:
+    SpectrumFrame current = {};
+    uint8_t levels[N] = {};
+    uint8_t flash = 0;
+
+    static uint16_t band_hue(int band, int count)
+    {
+        // Red for the lowest band through to magenta for the highest.
+        return band * (HSL_HUE_RANGE * 5 / 6) / count;
+    }
+
+    static void shade(uint8_t *rgb, uint16_t hue, uint8_t level)
+    {
+        hsl2rgb_int({hue, 255, uint8_t(level / 2)}, rgb);
+    }
+
+    void raise(int i, uint8_t target)
+    {
+        if (target > levels[i])
+            levels[i] = target;
+    }
+
+    static uint8_t fall(uint8_t v, uint8_t by) { return v > by ? v - by : 0; }
+
+    // Magnitude at position `pos` of `span`, interpolated between bands.
+    static uint8_t sample(const SpectrumFrame &f, int pos, int span, int &band)
+    {
+        const int scaled = pos * (f.band_count - 1) * 256 / (span > 1 ? span - 1 : 1);
+        const int frac = scaled & 0xFF;
+
+        band = scaled >> 8;
+        const int next = band + 1 < f.band_count ? band + 1 : band;
+        return (f.bands[band] * (256 - frac) + f.bands[next] * frac) >> 8;
+    }
+
+    int position(int i) const
+    {
+        const int half = (N + 1) / 2;
+        return current.mode == VIS_CENTER ? (i < half ? half - 1 - i : i - N / 2) : i;
+    }
+
+    int span() const { return current.mode == VIS_CENTER ? (N + 1) / 2 : N; }
+
+    int loudest() const
+    {
+        int loudest = 0;
+
+        for (int b = 1; b < current.band_count; b++)
+            if (current.bands[b] > current.bands[loudest])
+                loudest = b;
+
+        return loudest;
+    }
+
+public:
+    void update(const SpectrumFrame &f)
+    {
+        if (f.band_count == 0)
+            return;
+
+        current = f;
+
+        if (f.beat & SPECTRUM_BEAT)
+            flash = 255;
+
+        if (f.mode == VIS_PULSE)
+        {
+            int total = 0;
+
+            for (int b = 0; b < f.band_count; b++)
+                total += f.bands[b];
+
+            raise(0, total / f.band_count);
+            return;
+        }
+
+        for (int i = 0; i < N; i++)
+        {
+            int band;
+            raise(i, sample(f, position(i), span(), band));
+        }
+    }
+
+    // Draws the current levels into `rgb`, N RGB triplets in logical order,
+    // then decays them by one frame.
+    void draw(uint8_t *rgb)
+    {
+        if (current.band_count == 0)
+            return;
+
+        if (current.mode == VIS_PULSE)
+        {
+            uint8_t colour[3];
+            shade(colour, band_hue(loudest(), current.band_count), levels[0]);
+
+            for (int i = 0; i < N; i++)
+                std::memcpy(rgb + i * 3, colour, 3);
+        }
+        else
+        {
+            for (int i = 0; i < N; i++)
+            {
+                int band;
+                sample(current, position(i), span(), band);
+                shade(rgb + i * 3, band_hue(band, current.band_count), levels[i]);
+            }
+        }
+
+        for (int i = 0; i < N * 3; i++)
+            rgb[i] += (255 - rgb[i]) * flash / 255;
+
+        for (auto &l : levels)
+            l = fall(l, VISUALIZER_RELEASE);
+        flash = fall(flash, VISUALIZER_FLASH_RELEASE);
+    }
+
+    // True once every level and the flash have fallen to nothing.
+    bool is_idle() const
+    {
+        for (const auto l : levels)
+            if (l != 0)
+                return false;
+
+        return flash == 0;
+    }
+};
+
+#endif // VISUALIZER_HPP
@@ -8,6 +8,7 @@
 #include "cstring"
 #include "optional"
 #include "vector"
+#include "array"
 #include "algorithm"
 #include "string"
 
@@ -35,9 +36,9 @@ public:
         this->gateway_addr.addr = info.gw.addr;
     }
 
-    std::vector<uint8_t> get_ipv4_addr() const
+    std::array<uint8_t, 4> get_ipv4_addr() const
     {
-        std::vector<uint8_t> e(4);
+        std::array<uint8_t, 4> e;
         e[0] = esp_ip4_addr1(&this->ipv4_addr);
         e[1] = esp_ip4_addr2(&this->ipv4_addr);
         e[2] = esp_ip4_addr3(&this->ipv4_addr);
@@ -45,9 +46,9 @@ public:
         return e;
     }
 
-    std::vector<uint8_t> get_netmask_addr() const
+    std::array<uint8_t, 4> get_netmask_addr() const
     {
-        std::vector<uint8_t> e(4);
+        std::array<uint8_t, 4> e;
         e[0] = esp_ip4_addr1(&this->netmask_addr);
         e[1] = esp_ip4_addr2(&this->netmask_addr);
         e[2] = esp_ip4_addr3(&this->netmask_addr);
@@ -55,9 +56,9 @@ public:
         return e;
     }
 
-    std::vector<uint8_t> get_gateway_addr() const
+    std::array<uint8_t, 4> get_gateway_addr() const
     {
-        std::vector<uint8_t> e(4);
+        std::array<uint8_t, 4> e;
         e[0] = esp_ip4_addr1(&this->gateway_addr);
         e[1] = esp_ip4_addr2(&this->gateway_addr);
         e[2] = esp_ip4_addr3(&this->gateway_addr);
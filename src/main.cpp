@@ -1,25 +1,42 @@
+#include "drak/alloc_guard.hpp"
 #include "drak/udp.hpp"
 #include "drak/wifi.hpp"
 #include "drak/color.hpp"
 #include "drak/light_lang.hpp"
+#include "drak/pipeline.hpp"
+#include "drak/metrics.hpp"
+#include "drak/feedback.hpp"
+#include "drak/strip.hpp"
+#include "drak/board.hpp"
 #include "esp_event.h"
 #include "esp_http_server.h"
 #include "esp_log.h"
 #include "esp_netif.h"
+#include "esp_wifi.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "nvs_flash.h"
 #include "stdint.h"
 #include "driver/gpio.h"
-#include "led_strip.h"
 
-#define LED_COUNT 60
-#define STRIP_GPIO 12
+#define PROTOCOL_PORT 3000
+#define CONTROL_PORT 3001
+#define METRICS_PORT 80
 
-led_strip_handle_t led_strip;
+Strip<BoardStrip> strip;
+Metrics metrics;
+AnimLibrary anim_library;
 LightLangCompiler llc;
+Pipeline pipeline(llc);
+Feedback feedback(pipeline);
+UDP::Server udp_server(PROTOCOL_PORT);
 
-void on_start(Wifi *w) { w->connect(); }
+void on_start(Wifi *w)
+{
+    // Modem sleep would hold broadcast sync beacons and latches until the next DTIM.
+    esp_wifi_set_ps(WIFI_PS_NONE);
+    w->connect();
+}
 
 void on_connected(Wifi *_) { printf("Connected to Wi-Fi!\n"); }
 
@@ -37,10 +54,96 @@ void on_disconnected(Wifi *w)
     w->connect();
 }
 
-void on_socket_message(UDP::Server *_, const std::string &data, const std::string &sender_ip, uint16_t sender_port)
+void on_socket_message(UDP::Server *server, int endpoint, std::string_view data, const char *sender_ip,
+                       uint16_t sender_port)
+{
+    if (feedback.answer_discovery(server, endpoint, data, sender_ip, sender_port))
+        return;
+
+    const auto result = pipeline.submit(data);
+    feedback.acknowledge(server, endpoint, data, sender_ip, sender_port, result);
+}
+
+void on_socket_poll(UDP::Server *) { llc.poll(); }
+
+esp_err_t on_capture_control(httpd_req_t *req)
+{
+    auto *server = static_cast<UDP::Server *>(req->user_ctx);
+
+    if (std::strcmp(req->uri, "/capture/start") == 0)
+    {
+        if (!server->get_capture().enable())
+            return httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
+    }
+    else
+    {
+        server->get_capture().disable();
+    }
+
+    return httpd_resp_sendstr(req, "OK\n");
+}
+
+esp_err_t on_capture_dump(httpd_req_t *req)
+{
+    auto *server = static_cast<UDP::Server *>(req->user_ctx);
+
+    httpd_resp_set_type(req, "application/octet-stream");
+    server->get_capture().dump([req](const uint8_t *data, size_t len)
+                               { httpd_resp_send_chunk(req, reinterpret_cast<const char *>(data), len); });
+
+    return httpd_resp_send_chunk(req, nullptr, 0);
+}
+
+// The last presented frame as one "rrggbb" hex triplet per LED.
+esp_err_t on_frame_dump(httpd_req_t *req)
+{
+    char line[LED_COUNT * 6 + 2];
+
+    for (int i = 0; i < LED_COUNT; i++)
+    {
+        uint8_t r, g, b;
+        strip.get_pixel(i, r, g, b);
+        snprintf(line + i * 6, 7, "%02x%02x%02x", r, g, b);
+    }
+    line[LED_COUNT * 6] = '\n';
+    line[LED_COUNT * 6 + 1] = '\0';
+
+    httpd_resp_set_type(req, "text/plain");
+    return httpd_resp_sendstr(req, line);
+}
+
+void register_diagnostic_endpoints(httpd_handle_t http, UDP::Server *server)
 {
-    llc.terminate();
-    llc.execute(data);
+    const httpd_uri_t uris[] = {
+        {.uri = "/frame", .method = HTTP_GET, .handler = &on_frame_dump, .user_ctx = nullptr},
+        {.uri = "/capture/start", .method = HTTP_POST, .handler = &on_capture_control, .user_ctx = server},
+        {.uri = "/capture/stop", .method = HTTP_POST, .handler = &on_capture_control, .user_ctx = server},
+        {.uri = "/capture", .method = HTTP_GET, .handler = &on_capture_dump, .user_ctx = server},
+    };
+
+    for (const auto &uri : uris)
+        httpd_register_uri_handler(http, &uri);
+}
+
+// Everything the firmware needs once running is either static or reserved by
+// now; this is the fixed part of that budget.
+void print_memory_budget()
+{
+    printf("Static memory budget (bytes):\n");
+    printf("  strip          %6zu\n", sizeof(strip));
+    printf("  compiler       %6zu\n", sizeof(llc));
+    printf("  pipeline       %6zu\n", sizeof(pipeline));
+    printf("  metrics        %6zu\n", sizeof(metrics));
+    printf("  feedback       %6zu\n", sizeof(feedback));
+    printf("  anim library   %6zu\n", sizeof(anim_library));
+    printf("  udp server     %6zu\n", sizeof(udp_server));
+#ifdef LLC_STATIC_ALLOC
+    printf("  capture arena  %6zu\n", sizeof(UDP::capture_arena));
+#endif
+    printf("  udp stack      %6" PRIu32 "\n", UDP::TASK_STACK_SIZE);
+    printf("  render stack   %6" PRIu32 "\n", RENDER_STACK_SIZE);
+    printf("Heap free %" PRIu32 ", minimum %" PRIu32 "\n", esp_get_free_heap_size(),
+           esp_get_minimum_free_heap_size());
 }
 
 void on_got_ip(Wifi *w)
@@ -49,17 +152,44 @@ void on_got_ip(Wifi *w)
     printf("Got IP addr: %" PRIu8 ".%" PRIu8 ".%" PRIu8 ".%" PRIu8 "!\n",
            ipv4_addr[0], ipv4_addr[1], ipv4_addr[2], ipv4_addr[3]);
 
-    auto ws = UDP::Server(3000);
+    // Same protocol, but served ahead of any frame data queued on PROTOCOL_PORT.
+    const auto control = udp_server.add_endpoint(CONTROL_PORT, 1);
+
+    udp_server.add_on_message_listener(&on_socket_message);
 
-    ws.add_on_message_listener(&on_socket_message);
+    if (control.is_ok())
+        udp_server.add_on_message_listener(control.unwrap(), &on_socket_message);
 
-    auto is_err = ws.start();
+    udp_server.add_on_poll_listener(&on_socket_poll);
+
+    auto is_err = udp_server.start();
 
     if (is_err.is_err())
     {
         printf("Error while starting ws\n");
     }
 
+    metrics.watch_task("udp_server", udp_server.get_task_handle());
+    metrics.watch_task("llc_render", pipeline.get_task_handle());
+    metrics.watch_frames(&llc.get_frame_stats());
+
+    if (metrics.start(METRICS_PORT).is_err())
+    {
+        printf("Error while starting metrics server\n");
+    }
+    else
+    {
+        register_diagnostic_endpoints(metrics.get_http_server(), &udp_server);
+    }
+
+    if (feedback.start().is_err())
+    {
+        printf("Error while starting feedback timer\n");
+    }
+
+    print_memory_budget();
+    alloc_guard_arm();
+
     while (true)
         vTaskDelay(pdMS_TO_TICKS(2000));
 }
@@ -68,24 +198,10 @@ void on_lost_ip(Wifi *_) { printf("Lost IP address!\n"); }
 
 void configure_led(void)
 {
-    led_strip_config_t strip_config = {
-        .strip_gpio_num = STRIP_GPIO,
-        .max_leds = LED_COUNT,
-        .led_model = LED_MODEL_SK6812,
-        .color_component_format = LED_STRIP_COLOR_COMPONENT_FMT_GRB,
-        .flags = {
-            .invert_out = false,
-        }};
-
-    led_strip_rmt_config_t rmt_config = {
-        .clk_src = RMT_CLK_SRC_DEFAULT,
-        .resolution_hz = 10 * 1000 * 1000,
-        .mem_block_symbols = 64,
-        .flags = {
-            .with_dma = false,
-        }};
-
-    ESP_ERROR_CHECK(led_strip_new_rmt_device(&strip_config, &rmt_config, &led_strip));
+    if (strip.init().is_err())
+    {
+        printf("Error while configuring led strip\n");
+    }
 }
 
 extern "C" void app_main()
@@ -95,8 +211,18 @@ extern "C" void app_main()
     ESP_ERROR_CHECK(esp_event_loop_create_default());
 
     configure_led();
-    led_strip_set_pixel(led_strip, 1, 255, 0, 0);
-    led_strip_refresh(led_strip);
+    strip.set_pixel(1, 255, 0, 0);
+    strip.present();
+
+    if (anim_library.init("anim").is_err())
+    {
+        printf("Animation partition not found\n");
+    }
+
+    if (pipeline.start().is_err())
+    {
+        printf("Error while starting render task\n");
+    }
 
     auto wifi = new Wifi();
 
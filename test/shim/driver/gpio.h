@@ -0,0 +1,6 @@
+#ifndef SHIM_DRIVER_GPIO_H
+#define SHIM_DRIVER_GPIO_H
+
+typedef int gpio_num_t;
+
+#endif // SHIM_DRIVER_GPIO_H
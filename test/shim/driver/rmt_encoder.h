@@ -0,0 +1,40 @@
+#ifndef SHIM_DRIVER_RMT_ENCODER_H
+#define SHIM_DRIVER_RMT_ENCODER_H
+
+#include "driver/rmt_tx.h"
+
+typedef union
+{
+    struct
+    {
+        uint16_t duration0 : 15;
+        uint16_t level0 : 1;
+        uint16_t duration1 : 15;
+        uint16_t level1 : 1;
+    };
+    uint32_t val;
+} rmt_symbol_word_t;
+
+typedef struct
+{
+    rmt_symbol_word_t bit0;
+    rmt_symbol_word_t bit1;
+    struct
+    {
+        uint32_t msb_first : 1;
+    } flags;
+} rmt_bytes_encoder_config_t;
+
+inline esp_err_t rmt_new_bytes_encoder(const rmt_bytes_encoder_config_t *, rmt_encoder_handle_t *out)
+{
+    *out = new shim_rmt_encoder;
+    return ESP_OK;
+}
+
+inline esp_err_t rmt_del_encoder(rmt_encoder_handle_t encoder)
+{
+    delete encoder;
+    return ESP_OK;
+}
+
+#endif // SHIM_DRIVER_RMT_ENCODER_H
@@ -0,0 +1,156 @@
+#ifndef SHIM_DRIVER_RMT_TX_H
+#define SHIM_DRIVER_RMT_TX_H
+
+// Fake RMT TX channel. Nothing is clocked out: rmt_transmit() hands the bytes
+// to the recorder and completes at once, calling on_trans_done the way the
+// TX-done interrupt would.
+
+#include "driver/gpio.h"
+#include "esp_err.h"
+#include "esp_timer.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+
+typedef enum
+{
+    RMT_CLK_SRC_DEFAULT
+} rmt_clock_source_t;
+
+typedef struct
+{
+    gpio_num_t gpio_num;
+    rmt_clock_source_t clk_src;
+    uint32_t resolution_hz;
+    size_t mem_block_symbols;
+    size_t trans_queue_depth;
+    int intr_priority;
+    struct
+    {
+        uint32_t invert_out : 1;
+        uint32_t with_dma : 1;
+        uint32_t io_loop_back : 1;
+        uint32_t io_od_mode : 1;
+    } flags;
+} rmt_tx_channel_config_t;
+
+typedef struct
+{
+    size_t num_symbols;
+} rmt_tx_done_event_data_t;
+
+typedef struct
+{
+    int loop_count;
+    struct
+    {
+        uint32_t eot_level : 1;
+    } flags;
+} rmt_transmit_config_t;
+
+typedef struct shim_rmt_channel *rmt_channel_handle_t;
+typedef struct shim_rmt_encoder *rmt_encoder_handle_t;
+
+typedef bool (*rmt_tx_done_callback_t)(rmt_channel_handle_t channel, const rmt_tx_done_event_data_t *edata,
+                                       void *user_ctx);
+
+typedef struct
+{
+    rmt_tx_done_callback_t on_trans_done;
+} rmt_tx_event_callbacks_t;
+
+// Everything transmitted on any channel ends up here. `on_transmit`, if set,
+// is called on the transmitting task with each frame's wire bytes.
+struct ShimRmtRecorder
+{
+    static constexpr size_t capacity = 4096 * 4;
+
+    std::mutex mutex;
+    uint8_t last[capacity] = {};
+    size_t last_size = 0;
+    uint64_t transmits = 0;
+    void (*on_transmit)(const uint8_t *data, size_t size) = nullptr;
+
+    // Copies out the last frame; returns its size.
+    size_t copy_last(uint8_t *out, size_t size)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        const size_t n = size < last_size ? size : last_size;
+        std::memcpy(out, last, n);
+        return n;
+    }
+};
+
+inline ShimRmtRecorder shim_rmt_recorder;
+
+struct shim_rmt_channel
+{
+    gpio_num_t gpio;
+    rmt_tx_done_callback_t on_trans_done = nullptr;
+    void *user_ctx = nullptr;
+    bool enabled = false;
+};
+
+struct shim_rmt_encoder
+{
+};
+
+inline esp_err_t rmt_new_tx_channel(const rmt_tx_channel_config_t *config, rmt_channel_handle_t *out)
+{
+    *out = new shim_rmt_channel{config->gpio_num};
+    return ESP_OK;
+}
+
+inline esp_err_t rmt_tx_register_event_callbacks(rmt_channel_handle_t channel, const rmt_tx_event_callbacks_t *cbs,
+                                                 void *user_ctx)
+{
+    channel->on_trans_done = cbs->on_trans_done;
+    channel->user_ctx = user_ctx;
+    return ESP_OK;
+}
+
+inline esp_err_t rmt_enable(rmt_channel_handle_t channel)
+{
+    channel->enabled = true;
+    return ESP_OK;
+}
+
+inline esp_err_t rmt_disable(rmt_channel_handle_t channel)
+{
+    channel->enabled = false;
+    return ESP_OK;
+}
+
+inline esp_err_t rmt_del_channel(rmt_channel_handle_t channel)
+{
+    delete channel;
+    return ESP_OK;
+}
+
+inline esp_err_t rmt_transmit(rmt_channel_handle_t channel, rmt_encoder_handle_t, const void *data, size_t size,
+                              const rmt_transmit_config_t *)
+{
+    if (!channel->enabled || size > ShimRmtRecorder::capacity)
+        return ESP_ERR_INVALID_ARG;
+
+    ShimRmtRecorder &r = shim_rmt_recorder;
+    {
+        std::lock_guard<std::mutex> lock(r.mutex);
+        std::memcpy(r.last, data, size);
+        r.last_size = size;
+        r.transmits++;
+    }
+
+    if (r.on_transmit != nullptr)
+        r.on_transmit(static_cast<const uint8_t *>(data), size);
+
+    const rmt_tx_done_event_data_t done = {size * 8};
+
+    if (channel->on_trans_done != nullptr)
+        channel->on_trans_done(channel, &done, channel->user_ctx);
+
+    return ESP_OK;
+}
+
+#endif // SHIM_DRIVER_RMT_TX_H
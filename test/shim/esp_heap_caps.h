@@ -0,0 +1,6 @@
+#ifndef SHIM_ESP_HEAP_CAPS_H
+#define SHIM_ESP_HEAP_CAPS_H
+
+#include "esp_system.h"
+
+#endif // SHIM_ESP_HEAP_CAPS_H
@@ -0,0 +1,61 @@
+#ifndef SHIM_ESP_HTTP_SERVER_H
+#define SHIM_ESP_HTTP_SERVER_H
+
+// There is no HTTP server on the host: httpd_start() fails, and the response
+// calls exist only so that handlers compile.
+
+#include "esp_err.h"
+#include <cstddef>
+#include <cstdint>
+
+typedef void *httpd_handle_t;
+
+typedef enum
+{
+    HTTP_GET,
+    HTTP_POST
+} httpd_method_t;
+
+typedef enum
+{
+    HTTPD_404_NOT_FOUND,
+    HTTPD_500_INTERNAL_SERVER_ERROR
+} httpd_err_code_t;
+
+typedef struct
+{
+    httpd_handle_t handle;
+    httpd_method_t method;
+    char uri[512];
+    void *user_ctx;
+} httpd_req_t;
+
+typedef struct
+{
+    const char *uri;
+    httpd_method_t method;
+    esp_err_t (*handler)(httpd_req_t *req);
+    void *user_ctx;
+} httpd_uri_t;
+
+typedef struct
+{
+    unsigned task_priority;
+    size_t stack_size;
+    int core_id;
+    uint16_t server_port;
+    uint16_t max_uri_handlers;
+} httpd_config_t;
+
+#define HTTPD_DEFAULT_CONFIG() httpd_config_t{5, 4096, 0x7FFFFFFF, 80, 8}
+
+inline esp_err_t httpd_start(httpd_handle_t *, const httpd_config_t *) { return ESP_ERR_NOT_SUPPORTED; }
+inline esp_err_t httpd_stop(httpd_handle_t) { return ESP_OK; }
+inline esp_err_t httpd_register_uri_handler(httpd_handle_t, const httpd_uri_t *) { return ESP_ERR_NOT_SUPPORTED; }
+inline esp_err_t httpd_resp_set_type(httpd_req_t *, const char *) { return ESP_OK; }
+inline esp_err_t httpd_resp_sendstr(httpd_req_t *, const char *) { return ESP_OK; }
+inline esp_err_t httpd_resp_sendstr_chunk(httpd_req_t *, const char *) { return ESP_OK; }
+inline esp_err_t httpd_resp_send_chunk(httpd_req_t *, const char *, ptrdiff_t) { return ESP_OK; }
+inline esp_err_t httpd_resp_send_err(httpd_req_t *, httpd_err_code_t, const char *) { return ESP_OK; }
+
+#endif // SHIM_ESP_HTTP_SERVER_H
@@ -0,0 +1,11 @@
+#ifndef SHIM_ESP_LOG_H
+#define SHIM_ESP_LOG_H
+
+#include <cstdio>
+
+#define ESP_LOGE(tag, fmt, ...) std::fprintf(stderr, "E %s: " fmt "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGW(tag, fmt, ...) std::fprintf(stderr, "W %s: " fmt "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGI(tag, fmt, ...) std::fprintf(stderr, "I %s: " fmt "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGD(tag, fmt, ...) (void)(tag)
+
+#endif // SHIM_ESP_LOG_H
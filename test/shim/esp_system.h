@@ -0,0 +1,30 @@
+#ifndef SHIM_ESP_SYSTEM_H
+#define SHIM_ESP_SYSTEM_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <malloc.h>
+
+// Nominal heap the host figures are taken from, about what an ESP32-S3 has
+// free after Wi-Fi is up.
+constexpr uint32_t SHIM_HEAP_SIZE = 300 * 1024;
+
+// Bytes currently allocated from the C heap, by any thread.
+inline uint32_t shim_heap_used() { return mallinfo2().uordblks; }
+
+inline uint32_t esp_get_free_heap_size()
+{
+    const uint32_t used = shim_heap_used();
+    return used < SHIM_HEAP_SIZE ? SHIM_HEAP_SIZE - used : 0;
+}
+
+inline uint32_t esp_get_minimum_free_heap_size() { return esp_get_free_heap_size(); }
+
+[[noreturn]] inline void esp_system_abort(const char *details)
+{
+    std::fprintf(stderr, "abort: %s\n", details);
+    std::abort();
+}
+
+#endif // SHIM_ESP_SYSTEM_H
@@ -0,0 +1,125 @@
+#ifndef SHIM_ESP_TIMER_H
+#define SHIM_ESP_TIMER_H
+
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include <cstdint>
+#include <ctime>
+
+inline int64_t esp_timer_get_time()
+{
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return int64_t(now.tv_sec) * 1000 * 1000 + now.tv_nsec / 1000;
+}
+
+typedef void (*esp_timer_cb_t)(void *arg);
+
+typedef enum
+{
+    ESP_TIMER_TASK,
+    ESP_TIMER_ISR
+} esp_timer_dispatch_t;
+
+typedef struct
+{
+    esp_timer_cb_t callback;
+    void *arg;
+    esp_timer_dispatch_t dispatch_method;
+    const char *name;
+    bool skip_unhandled_events;
+} esp_timer_create_args_t;
+
+namespace shim
+{
+    // One thread per armed timer. Callbacks run on it, as ESP_TIMER_TASK
+    // callbacks run on the esp_timer task.
+    struct Timer : Waitable
+    {
+        esp_timer_create_args_t args;
+        pthread_t thread{};
+        uint64_t period_us = 0;
+        bool periodic = false;
+        bool armed = false;
+        bool running = false;
+
+        static void *run(void *arg)
+        {
+            Timer *t = static_cast<Timer *>(arg);
+            int64_t due = esp_timer_get_time() + t->period_us;
+
+            while (true)
+            {
+                {
+                    Lock lock(*t);
+                    const TickType_t ticks = TickType_t((t->period_us + 9999) / 10000);
+
+                    while (t->armed && esp_timer_get_time() < due)
+                        t->wait(ticks, [t, due] { return !t->armed || esp_timer_get_time() >= due; });
+
+                    if (!t->armed)
+                        return nullptr;
+                }
+
+                t->args.callback(t->args.arg);
+
+                if (!t->periodic)
+                    return nullptr;
+
+                due += t->period_us;
+            }
+        }
+
+        esp_err_t start(uint64_t us, bool repeat)
+        {
+            if (running)
+                return ESP_FAIL;
+
+            period_us = us;
+            periodic = repeat;
+            armed = true;
+            running = pthread_create(&thread, nullptr, &Timer::run, this) == 0;
+            return running ? ESP_OK : ESP_FAIL;
+        }
+
+        esp_err_t stop()
+        {
+            if (!running)
+                return ESP_FAIL;
+
+            {
+                Lock lock(*this);
+                armed = false;
+                pthread_cond_signal(&cond);
+            }
+
+            pthread_join(thread, nullptr);
+            running = false;
+            return ESP_OK;
+        }
+    };
+}
+
+typedef shim::Timer *esp_timer_handle_t;
+
+inline esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *out)
+{
+    *out = new shim::Timer;
+    (*out)->args = *args;
+    return ESP_OK;
+}
+
+inline esp_err_t esp_timer_start_periodic(esp_timer_handle_t t, uint64_t period_us) { return t->start(period_us, true); }
+
+inline esp_err_t esp_timer_start_once(esp_timer_handle_t t, uint64_t timeout_us) { return t->start(timeout_us, false); }
+
+inline esp_err_t esp_timer_stop(esp_timer_handle_t t) { return t->stop(); }
+
+inline esp_err_t esp_timer_delete(esp_timer_handle_t t)
+{
+    t->stop();
+    delete t;
+    return ESP_OK;
+}
+
+#endif // SHIM_ESP_TIMER_H
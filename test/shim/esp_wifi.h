@@ -0,0 +1,16 @@
+#ifndef SHIM_ESP_WIFI_H
+#define SHIM_ESP_WIFI_H
+
+// Loopback has no access point; the RSSI query always fails.
+
+#include "esp_err.h"
+#include <cstdint>
+
+typedef struct
+{
+    int8_t rssi;
+} wifi_ap_record_t;
+
+inline esp_err_t esp_wifi_sta_get_ap_info(wifi_ap_record_t *) { return ESP_FAIL; }
+
+#endif // SHIM_ESP_WIFI_H
@@ -0,0 +1,136 @@
+#ifndef SHIM_FREERTOS_H
+#define SHIM_FREERTOS_H
+
+// Host shim: FreeRTOS tasks, notifications and semaphores on POSIX threads.
+// Only what the drak headers use is provided. Blocking calls are pthread
+// cancellation points, so vTaskDelete() can stop a task wherever it waits,
+// as it would on the device.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <ctime>
+#include <new>
+#include <pthread.h>
+
+typedef int BaseType_t;
+typedef unsigned UBaseType_t;
+typedef uint32_t TickType_t;
+typedef void (*TaskFunction_t)(void *);
+
+#define pdFALSE 0
+#define pdTRUE 1
+#define pdFAIL 0
+#define pdPASS 1
+#define portMAX_DELAY 0xFFFFFFFFu
+
+// Same tick rate as sdkconfig, so tick rounding behaves as on the device.
+#define configTICK_RATE_HZ 100
+#define portTICK_PERIOD_MS (1000 / configTICK_RATE_HZ)
+#define pdMS_TO_TICKS(ms) ((TickType_t)(((uint64_t)(ms) * configTICK_RATE_HZ) / 1000))
+
+#define portNUM_PROCESSORS 2
+#define PRO_CPU_NUM 0
+#define APP_CPU_NUM 1
+#define tskIDLE_PRIORITY 0
+
+namespace shim
+{
+    // A condition variable on CLOCK_MONOTONIC, and the lock guard both the
+    // task and semaphore waits use. The guard also unlocks when a wait is
+    // cancelled, since cancellation unwinds the stack.
+    struct Waitable
+    {
+        pthread_mutex_t mutex;
+        pthread_cond_t cond;
+
+        Waitable()
+        {
+            pthread_condattr_t attr;
+            pthread_condattr_init(&attr);
+            pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+            pthread_cond_init(&cond, &attr);
+            pthread_condattr_destroy(&attr);
+            pthread_mutex_init(&mutex, nullptr);
+        }
+
+        ~Waitable()
+        {
+            pthread_cond_destroy(&cond);
+            pthread_mutex_destroy(&mutex);
+        }
+
+        // Waits until `ready()` or `ticks` run out; returns ready().
+        template <typename Ready>
+        bool wait(TickType_t ticks, Ready ready)
+        {
+            timespec deadline;
+            clock_gettime(CLOCK_MONOTONIC, &deadline);
+
+            const uint64_t ns = uint64_t(ticks) * portTICK_PERIOD_MS * 1000 * 1000;
+            deadline.tv_sec += ns / 1000000000 + (deadline.tv_nsec + ns % 1000000000) / 1000000000;
+            deadline.tv_nsec = (deadline.tv_nsec + ns % 1000000000) % 1000000000;
+
+            while (!ready())
+            {
+                if (ticks == 0)
+                    return false;
+
+                const int err = ticks == portMAX_DELAY ? pthread_cond_wait(&cond, &mutex)
+                                                       : pthread_cond_timedwait(&cond, &mutex, &deadline);
+                if (err != 0)
+                    return ready();
+            }
+
+            return true;
+        }
+    };
+
+    class Lock
+    {
+    private:
+        pthread_mutex_t &mutex;
+
+    public:
+        explicit Lock(Waitable &w) : mutex(w.mutex) { pthread_mutex_lock(&mutex); }
+        ~Lock() { pthread_mutex_unlock(&mutex); }
+    };
+
+    struct Task : Waitable
+    {
+        pthread_t thread{};
+        TaskFunction_t function = nullptr;
+        void *arg = nullptr;
+        BaseType_t core = 0;
+        uint32_t notified = 0;
+        bool started = false;
+    };
+
+    // FreeRTOS takes task control blocks from pvPortMalloc, which the
+    // LLC_STATIC_ALLOC guard on operator new does not see; nor should the shim's.
+    inline Task *new_task() { return ::new (std::malloc(sizeof(Task))) Task; }
+
+    inline void free_task(Task *task)
+    {
+        task->~Task();
+        std::free(task);
+    }
+
+    // The task the calling thread runs; threads not started by
+    // xTaskCreate*() get one on first use.
+    inline Task *&current_task()
+    {
+        thread_local Task *task = nullptr;
+
+        if (task == nullptr)
+            task = new_task();
+
+        return task;
+    }
+}
+
+typedef shim::Task *TaskHandle_t;
+
+inline BaseType_t xPortGetCoreID() { return shim::current_task()->core; }
+
+#endif // SHIM_FREERTOS_H
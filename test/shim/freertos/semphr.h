@@ -0,0 +1,63 @@
+#ifndef SHIM_SEMPHR_H
+#define SHIM_SEMPHR_H
+
+#include "FreeRTOS.h"
+
+namespace shim
+{
+    // Counting semaphore; a mutex is one that starts given. Like FreeRTOS
+    // mutexes, it is not recursive.
+    struct Semaphore : Waitable
+    {
+        UBaseType_t count;
+        UBaseType_t max;
+
+        Semaphore(UBaseType_t initial, UBaseType_t limit) : count(initial), max(limit) {}
+    };
+}
+
+typedef shim::Semaphore *SemaphoreHandle_t;
+
+inline SemaphoreHandle_t xSemaphoreCreateMutex() { return new shim::Semaphore(1, 1); }
+
+inline SemaphoreHandle_t xSemaphoreCreateBinary() { return new shim::Semaphore(0, 1); }
+
+inline SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max, UBaseType_t initial)
+{
+    return new shim::Semaphore(initial, max);
+}
+
+inline BaseType_t xSemaphoreTake(SemaphoreHandle_t s, TickType_t ticks)
+{
+    shim::Lock lock(*s);
+
+    if (!s->wait(ticks, [s] { return s->count > 0; }))
+        return pdFALSE;
+
+    s->count--;
+    return pdTRUE;
+}
+
+inline BaseType_t xSemaphoreGive(SemaphoreHandle_t s)
+{
+    shim::Lock lock(*s);
+
+    if (s->count >= s->max)
+        return pdFALSE;
+
+    s->count++;
+    pthread_cond_signal(&s->cond);
+    return pdTRUE;
+}
+
+inline BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t s, BaseType_t *woken)
+{
+    if (woken != nullptr)
+        *woken = pdTRUE;
+
+    return xSemaphoreGive(s);
+}
+
+inline void vSemaphoreDelete(SemaphoreHandle_t s) { delete s; }
+
+#endif // SHIM_SEMPHR_H
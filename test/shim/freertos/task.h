@@ -0,0 +1,117 @@
+#ifndef SHIM_TASK_H
+#define SHIM_TASK_H
+
+#include "FreeRTOS.h"
+#include <ctime>
+
+namespace shim
+{
+    inline void *task_entry(void *arg)
+    {
+        Task *task = static_cast<Task *>(arg);
+        current_task() = task;
+        task->function(task->arg);
+        return nullptr;
+    }
+}
+
+// The stack size is ignored; host threads get the default stack.
+inline BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char *, uint32_t, void *arg, UBaseType_t,
+                                          TaskHandle_t *handle, BaseType_t core)
+{
+    auto *task = shim::new_task();
+    task->function = function;
+    task->arg = arg;
+    task->core = core;
+
+    if (pthread_create(&task->thread, nullptr, shim::task_entry, task) != 0)
+    {
+        shim::free_task(task);
+        return pdFAIL;
+    }
+
+    task->started = true;
+
+    if (handle != nullptr)
+        *handle = task;
+
+    return pdPASS;
+}
+
+inline BaseType_t xTaskCreate(TaskFunction_t function, const char *name, uint32_t stack, void *arg,
+                              UBaseType_t priority, TaskHandle_t *handle)
+{
+    return xTaskCreatePinnedToCore(function, name, stack, arg, priority, handle, 0);
+}
+
+// Stops the task at its next blocking call and waits for it. The handle is
+// not freed, so late notifications to it stay harmless.
+inline void vTaskDelete(TaskHandle_t task)
+{
+    if (task == nullptr || task == shim::current_task())
+        pthread_exit(nullptr);
+
+    if (task->started)
+    {
+        pthread_cancel(task->thread);
+        pthread_join(task->thread, nullptr);
+        task->started = false;
+    }
+}
+
+inline TaskHandle_t xTaskGetCurrentTaskHandle() { return shim::current_task(); }
+
+inline void vTaskDelay(TickType_t ticks)
+{
+    const uint64_t ns = uint64_t(ticks) * portTICK_PERIOD_MS * 1000 * 1000;
+    timespec t = {time_t(ns / 1000000000), long(ns % 1000000000)};
+
+    while (nanosleep(&t, &t) != 0)
+    {
+    }
+}
+
+inline TickType_t xTaskGetTickCount()
+{
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return TickType_t((uint64_t(now.tv_sec) * 1000 + now.tv_nsec / 1000000) / portTICK_PERIOD_MS);
+}
+
+inline BaseType_t xTaskNotifyGive(TaskHandle_t task)
+{
+    shim::Lock lock(*task);
+    task->notified++;
+    pthread_cond_signal(&task->cond);
+    return pdPASS;
+}
+
+inline void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *woken)
+{
+    xTaskNotifyGive(task);
+
+    if (woken != nullptr)
+        *woken = pdTRUE;
+}
+
+inline uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks)
+{
+    shim::Task *task = shim::current_task();
+    shim::Lock lock(*task);
+
+    task->wait(ticks, [task] { return task->notified > 0; });
+
+    const uint32_t value = task->notified;
+
+    if (value > 0)
+        task->notified = clear ? 0 : value - 1;
+
+    return value;
+}
+
+// Host stacks are not watched.
+inline UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t) { return 0; }
+
+#define portYIELD_FROM_ISR(woken) (void)(woken)
+
+#endif // SHIM_TASK_H
@@ -0,0 +1,4 @@
+#ifndef SHIM_LWIP_ERR_H
+#define SHIM_LWIP_ERR_H
+
+#endif // SHIM_LWIP_ERR_H
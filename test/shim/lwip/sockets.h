@@ -0,0 +1,17 @@
+#ifndef SHIM_LWIP_SOCKETS_H
+#define SHIM_LWIP_SOCKETS_H
+
+// lwIP's BSD socket API is close enough to the host's to use it directly.
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+inline char *inet_ntoa_r(struct in_addr addr, char *buf, int len)
+{
+    return const_cast<char *>(inet_ntop(AF_INET, &addr, buf, len));
+}
+
+#endif // SHIM_LWIP_SOCKETS_H
@@ -0,0 +1,95 @@
+// The guard aborts the process, so each armed allocation runs in a forked
+// child and the parent checks how it died.
+
+#ifndef LLC_STATIC_ALLOC
+#error "build with -DLLC_STATIC_ALLOC: pio test -e native-static"
+#endif
+
+#include "drak/alloc_guard.hpp"
+#include <csignal>
+#include <new>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <unity.h>
+
+struct alignas(64) Aligned
+{
+    uint8_t bytes[64];
+};
+
+// Keeps the compiler from eliding the allocations under test.
+static void *volatile sink;
+
+void setUp() {}
+
+void tearDown() {}
+
+// Runs `allocate` in a child with the guard armed; returns the signal that
+// ended it, 0 if it exited normally.
+template <typename Allocate>
+static int signal_after_arming(Allocate allocate)
+{
+    const pid_t pid = fork();
+
+    if (pid == 0)
+    {
+        alloc_guard_arm();
+        allocate();
+        _exit(0);
+    }
+
+    int status = 0;
+    waitpid(pid, &status, 0);
+    return WIFSIGNALED(status) ? WTERMSIG(status) : 0;
+}
+
+void test_unarmed_allocations_pass()
+{
+    int *i = new int(1);
+    Aligned *a = new Aligned;
+
+    TEST_ASSERT_NOT_NULL(i);
+    TEST_ASSERT_EQUAL(0, reinterpret_cast<uintptr_t>(a) % alignof(Aligned));
+
+    delete i;
+    delete a;
+}
+
+void test_new_aborts_once_armed()
+{
+    TEST_ASSERT_EQUAL(SIGABRT, signal_after_arming([] { sink = new int(1); }));
+}
+
+void test_array_new_aborts_once_armed()
+{
+    TEST_ASSERT_EQUAL(SIGABRT, signal_after_arming([] { sink = new int[16]; }));
+}
+
+void test_nothrow_new_aborts_once_armed()
+{
+    TEST_ASSERT_EQUAL(SIGABRT, signal_after_arming([] { sink = new (std::nothrow) int(1); }));
+}
+
+void test_aligned_new_aborts_once_armed()
+{
+    TEST_ASSERT_EQUAL(SIGABRT, signal_after_arming([] { sink = new Aligned; }));
+    TEST_ASSERT_EQUAL(SIGABRT, signal_after_arming([] { sink = new Aligned[4]; }));
+    TEST_ASSERT_EQUAL(SIGABRT, signal_after_arming([] { sink = new (std::nothrow) Aligned; }));
+}
+
+void test_armed_child_without_allocations_exits()
+{
+    TEST_ASSERT_EQUAL(0, signal_after_arming([] {}));
+}
+
+int main(int, char **)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_unarmed_allocations_pass);
+    RUN_TEST(test_new_aborts_once_armed);
+    RUN_TEST(test_array_new_aborts_once_armed);
+    RUN_TEST(test_nothrow_new_aborts_once_armed);
+    RUN_TEST(test_aligned_new_aborts_once_armed);
+    RUN_TEST(test_armed_child_without_allocations_exits);
+    return UNITY_END();
+}
@@ -0,0 +1,146 @@
+#include "drak/anim.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <unity.h>
+#include <vector>
+
+constexpr uint16_t OP_COUNT = 3000;
+constexpr size_t SLOTS = 2;
+
+static char storage_path[] = "/tmp/llc_anim_XXXXXX";
+static AnimLibrary *library;
+
+// A chase repeating every 30 ops (240 bytes, inside the LZ window) with a
+// long delay every 97th op, so the LZ path mixes matches and literals.
+static std::vector<AnimOp> make_ops()
+{
+    std::vector<AnimOp> ops(OP_COUNT);
+
+    for (uint16_t i = 0; i < OP_COUNT; i++)
+        ops[i] = {uint16_t(i % 30), uint8_t(i % 10 * 25), uint8_t(255 - i % 10), uint8_t(i % 3 * 100),
+                  i % 97 == 0 ? ANIM_MAX_DELAY : uint32_t(i % 30 == 0 ? 40 : 0)};
+
+    return ops;
+}
+
+static void upload(uint8_t slot, const uint8_t *blob, size_t size)
+{
+    const uint16_t total = (size + ANIM_CHUNK_SIZE - 1) / ANIM_CHUNK_SIZE;
+
+    for (uint16_t seq = 0; seq < total; seq++)
+    {
+        const size_t offset = size_t(seq) * ANIM_CHUNK_SIZE;
+        const size_t len = size - offset < ANIM_CHUNK_SIZE ? size - offset : ANIM_CHUNK_SIZE;
+
+        TEST_ASSERT_TRUE(library->upload(slot, seq, total, blob + offset, len).is_ok());
+    }
+}
+
+static void check_round_trip(bool compress)
+{
+    const auto ops = make_ops();
+    std::vector<uint8_t> blob(ANIM_HEADER_SIZE + OP_COUNT * ANIM_OP_SIZE);
+
+    const size_t size = anim_encode(ops.data(), OP_COUNT, true, compress, blob.data(), blob.size());
+    TEST_ASSERT_GREATER_THAN(0, size);
+
+    AnimHeader header;
+    TEST_ASSERT_TRUE(anim_read_header(blob.data(), header));
+    TEST_ASSERT_EQUAL(compress, (header.flags & ANIM_FLAG_LZ) != 0);
+
+    upload(1, blob.data(), size);
+
+    AnimReader reader;
+    AnimOp op;
+    TEST_ASSERT_TRUE(reader.begin(library->find(1)));
+    TEST_ASSERT_TRUE(reader.loop());
+
+    for (uint16_t i = 0; i < OP_COUNT; i++)
+    {
+        TEST_ASSERT_TRUE(reader.next(op));
+        TEST_ASSERT_EQUAL(ops[i].index, op.index);
+        TEST_ASSERT_EQUAL(ops[i].r, op.r);
+        TEST_ASSERT_EQUAL(ops[i].g, op.g);
+        TEST_ASSERT_EQUAL(ops[i].b, op.b);
+        TEST_ASSERT_EQUAL(ops[i].delay, op.delay);
+    }
+
+    TEST_ASSERT_FALSE(reader.next(op));
+}
+
+void setUp()
+{
+    const int fd = mkstemp(storage_path);
+    TEST_ASSERT_TRUE(fd >= 0);
+    TEST_ASSERT_EQUAL(0, ftruncate(fd, SLOTS * ANIM_SLOT_SIZE));
+    close(fd);
+
+    library = new AnimLibrary();
+    TEST_ASSERT_TRUE(library->init(storage_path).is_ok());
+}
+
+void tearDown()
+{
+    delete library;
+    unlink(storage_path);
+    std::snprintf(storage_path, sizeof(storage_path), "/tmp/llc_anim_XXXXXX");
+}
+
+void test_raw_round_trip() { check_round_trip(false); }
+
+void test_lz_round_trip() { check_round_trip(true); }
+
+void test_slot_is_not_playable_until_last_chunk()
+{
+    const auto ops = make_ops();
+    std::vector<uint8_t> blob(ANIM_HEADER_SIZE + OP_COUNT * ANIM_OP_SIZE);
+    const size_t size = anim_encode(ops.data(), OP_COUNT, false, false, blob.data(), blob.size());
+    const uint16_t total = (size + ANIM_CHUNK_SIZE - 1) / ANIM_CHUNK_SIZE;
+
+    for (uint16_t seq = 0; seq + 1 < total; seq++)
+    {
+        TEST_ASSERT_TRUE(library->upload(0, seq, total, blob.data() + seq * ANIM_CHUNK_SIZE, ANIM_CHUNK_SIZE).is_ok());
+        TEST_ASSERT_NULL(library->find(0));
+    }
+}
+
+void test_short_first_chunk_is_a_size_error()
+{
+    const uint8_t chunk[ANIM_HEADER_SIZE - 1] = {};
+    const auto res = library->upload(0, 0, 1, chunk, sizeof(chunk));
+
+    TEST_ASSERT_TRUE(res.is_err());
+    TEST_ASSERT_EQUAL(AnimLibrary::TOO_SMALL, res.unwrap_err());
+}
+
+void test_playing_slot_is_not_erased()
+{
+    const auto ops = make_ops();
+    std::vector<uint8_t> blob(ANIM_HEADER_SIZE + OP_COUNT * ANIM_OP_SIZE);
+    const size_t size = anim_encode(ops.data(), 100, false, false, blob.data(), blob.size());
+
+    upload(0, blob.data(), size);
+    TEST_ASSERT_TRUE(library->begin_playback(0));
+
+    const auto res = library->upload(0, 0, 1, blob.data(), size);
+    TEST_ASSERT_TRUE(res.is_err());
+    TEST_ASSERT_EQUAL(AnimLibrary::SLOT_BUSY, res.unwrap_err());
+    TEST_ASSERT_NOT_NULL(library->find(0));
+
+    // Other slots stay writable.
+    upload(1, blob.data(), size);
+
+    library->end_playback();
+    upload(0, blob.data(), size);
+}
+
+int main(int, char **)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_raw_round_trip);
+    RUN_TEST(test_lz_round_trip);
+    RUN_TEST(test_slot_is_not_playable_until_last_chunk);
+    RUN_TEST(test_short_first_chunk_is_a_size_error);
+    RUN_TEST(test_playing_slot_is_not_erased);
+    return UNITY_END();
+}
@@ -0,0 +1,161 @@
+#include "drak/color.hpp"
+#include <unity.h>
+
+// Transforms one pixel.
+static void apply(const ColorTransform &t, uint8_t r, uint8_t g, uint8_t b, uint8_t *out)
+{
+    const uint8_t in[3] = {r, g, b};
+    t.apply(in, out, 1);
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_default_is_identity()
+{
+    ColorTransform t;
+    TEST_ASSERT_TRUE(t.is_identity());
+
+    uint8_t frame[4 * 3], out[4 * 3];
+    for (int i = 0; i < 12; i++)
+        frame[i] = i * 21;
+
+    t.apply(frame, out, 4);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(frame, out, sizeof(frame));
+
+    t.tint_amount = 1;
+    TEST_ASSERT_FALSE(t.is_identity());
+}
+
+// The integer HSL conversion round-trips to within a couple of steps.
+void test_integer_hsl_round_trip()
+{
+    int worst = 0;
+
+    for (int r = 0; r < 256; r += 5)
+        for (int g = 0; g < 256; g += 5)
+            for (int b = 0; b < 256; b += 5)
+            {
+                uint8_t out[3];
+                hsl2rgb_int(rgb2hsl_int(r, g, b), out);
+
+                worst = MAX(worst, abs(out[0] - r));
+                worst = MAX(worst, abs(out[1] - g));
+                worst = MAX(worst, abs(out[2] - b));
+            }
+
+    TEST_ASSERT_LESS_OR_EQUAL(3, worst);
+}
+
+// A third of a turn takes each primary to the next.
+void test_hue_shift()
+{
+    ColorTransform t;
+    uint8_t out[3];
+
+    t.hue_shift = HSL_HUE_RANGE / 3;
+    apply(t, 255, 0, 0, out);
+    TEST_ASSERT_UINT_WITHIN(1, 0, out[0]);
+    TEST_ASSERT_UINT_WITHIN(1, 255, out[1]);
+    TEST_ASSERT_UINT_WITHIN(1, 0, out[2]);
+
+    apply(t, 0, 0, 255, out);
+    TEST_ASSERT_UINT_WITHIN(1, 255, out[0]);
+    TEST_ASSERT_UINT_WITHIN(1, 0, out[1]);
+    TEST_ASSERT_UINT_WITHIN(1, 0, out[2]);
+
+    // Greys have no hue to turn.
+    apply(t, 90, 90, 90, out);
+    TEST_ASSERT_EQUAL(90, out[0]);
+    TEST_ASSERT_EQUAL(90, out[1]);
+    TEST_ASSERT_EQUAL(90, out[2]);
+}
+
+void test_saturation()
+{
+    ColorTransform t;
+    uint8_t out[3];
+
+    // None left: the grey of the same lightness.
+    t.saturation = 0;
+    apply(t, 200, 100, 50, out);
+    TEST_ASSERT_EQUAL(125, out[0]);
+    TEST_ASSERT_EQUAL(125, out[1]);
+    TEST_ASSERT_EQUAL(125, out[2]);
+
+    // Doubled, clamped at full saturation: the channels spread apart.
+    t.saturation = 512;
+    apply(t, 150, 100, 100, out);
+    TEST_ASSERT_GREATER_THAN(150, out[0]);
+    TEST_ASSERT_LESS_THAN(100, out[1]);
+    TEST_ASSERT_UINT_WITHIN(1, out[1], out[2]);
+}
+
+void test_lightness()
+{
+    ColorTransform t;
+    uint8_t out[3];
+
+    t.lightness = 0;
+    apply(t, 200, 100, 50, out);
+    TEST_ASSERT_EQUAL(0, out[0] + out[1] + out[2]);
+
+    t.lightness = 512;
+    apply(t, 60, 60, 60, out);
+    TEST_ASSERT_UINT_WITHIN(1, 120, out[0]);
+
+    // Clamped at white.
+    apply(t, 200, 200, 200, out);
+    TEST_ASSERT_EQUAL(255, out[0]);
+}
+
+void test_tint()
+{
+    ColorTransform t;
+    uint8_t out[3];
+
+    t.tint[0] = 255, t.tint[1] = 128, t.tint[2] = 0;
+
+    t.tint_amount = 255;
+    apply(t, 10, 20, 30, out);
+    TEST_ASSERT_EQUAL(255, out[0]);
+    TEST_ASSERT_EQUAL(128, out[1]);
+    TEST_ASSERT_EQUAL(0, out[2]);
+
+    // Half way, from either side of the tint.
+    t.tint_amount = 128;
+    apply(t, 0, 255, 100, out);
+    TEST_ASSERT_UINT_WITHIN(1, 128, out[0]);
+    TEST_ASSERT_UINT_WITHIN(1, 191, out[1]);
+    TEST_ASSERT_UINT_WITHIN(1, 50, out[2]);
+}
+
+// HSL changes come first, then the tint blends over the result.
+void test_hue_then_tint()
+{
+    ColorTransform t;
+    uint8_t out[3];
+
+    t.hue_shift = HSL_HUE_RANGE / 3;
+    t.tint[2] = 255;
+    t.tint_amount = 128;
+
+    apply(t, 255, 0, 0, out);
+    TEST_ASSERT_UINT_WITHIN(1, 0, out[0]);
+    TEST_ASSERT_UINT_WITHIN(1, 127, out[1]);
+    TEST_ASSERT_UINT_WITHIN(1, 128, out[2]);
+}
+
+int main(int, char **)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_default_is_identity);
+    RUN_TEST(test_integer_hsl_round_trip);
+    RUN_TEST(test_hue_shift);
+    RUN_TEST(test_saturation);
+    RUN_TEST(test_lightness);
+    RUN_TEST(test_tint);
+    RUN_TEST(test_hue_then_tint);
+    return UNITY_END();
+}
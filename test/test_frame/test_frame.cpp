@@ -0,0 +1,232 @@
+#include "drak/frame.hpp"
+#include <chrono>
+#include <thread>
+#include <unity.h>
+
+constexpr int N = 8;
+
+static FrameAssembler<N> *assembler;
+
+static uint32_t rejected() { return assembler->get_stats().fragments_rejected.load(); }
+
+static uint32_t dropped() { return assembler->get_stats().frames_dropped.load(); }
+
+// Sends fragment `index` of `count` for frame `id`, setting LED `index` to `v`.
+static bool fragment(uint16_t id, uint8_t index, uint8_t count, uint8_t v)
+{
+    if (!assembler->begin_fragment(id, index, count))
+        return false;
+
+    assembler->set_pixel(index, v, v, v);
+    return true;
+}
+
+static uint8_t red(int index) { return assembler->pixels()[index * 3]; }
+
+void setUp() { assembler = new FrameAssembler<N>; }
+
+void tearDown() { delete assembler; }
+
+void test_frame_presents_once_every_fragment_arrived()
+{
+    TEST_ASSERT_TRUE(fragment(1, 0, 2, 10));
+    TEST_ASSERT_FALSE(assembler->finish_fragment());
+    TEST_ASSERT_EQUAL(0, red(0));
+
+    TEST_ASSERT_TRUE(fragment(1, 1, 2, 20));
+    TEST_ASSERT_TRUE(assembler->finish_fragment());
+    TEST_ASSERT_EQUAL(10, red(0));
+    TEST_ASSERT_EQUAL(20, red(1));
+    TEST_ASSERT_TRUE(assembler->is_presented(1));
+    TEST_ASSERT_EQUAL(1, assembler->get_stats().frames_completed.load());
+}
+
+// LEDs a frame does not touch keep the colour of the frame before.
+void test_untouched_leds_keep_their_colour()
+{
+    fragment(1, 5, 6, 50);
+    for (int i = 0; i < 5; i++)
+        fragment(1, i, 6, 1);
+    TEST_ASSERT_TRUE(assembler->finish_fragment());
+
+    TEST_ASSERT_TRUE(fragment(2, 0, 1, 7));
+    TEST_ASSERT_TRUE(assembler->finish_fragment());
+
+    TEST_ASSERT_EQUAL(7, red(0));
+    TEST_ASSERT_EQUAL(50, red(5));
+}
+
+void test_duplicate_fragment_is_rejected()
+{
+    TEST_ASSERT_TRUE(fragment(1, 0, 2, 10));
+    TEST_ASSERT_FALSE(fragment(1, 0, 2, 99));
+    TEST_ASSERT_EQUAL(1, rejected());
+
+    TEST_ASSERT_TRUE(fragment(1, 1, 2, 20));
+    TEST_ASSERT_TRUE(assembler->finish_fragment());
+    TEST_ASSERT_EQUAL(10, red(0));
+}
+
+void test_bad_headers_are_rejected()
+{
+    TEST_ASSERT_FALSE(assembler->begin_fragment(1, 0, 0));
+    TEST_ASSERT_FALSE(assembler->begin_fragment(1, 2, 2));
+    TEST_ASSERT_FALSE(assembler->begin_fragment(1, 0, MAX_FRAME_FRAGMENTS + 1));
+    TEST_ASSERT_EQUAL(3, rejected());
+
+    // The count is fixed by the first fragment of a frame.
+    TEST_ASSERT_TRUE(fragment(1, 0, 4, 1));
+    TEST_ASSERT_FALSE(fragment(1, 1, 3, 1));
+    TEST_ASSERT_EQUAL(4, rejected());
+}
+
+// A frame of MAX_FRAME_FRAGMENTS uses every bit of the received mask.
+void test_largest_fragment_count_completes()
+{
+    for (int i = 0; i < MAX_FRAME_FRAGMENTS; i++)
+    {
+        TEST_ASSERT_TRUE(assembler->begin_fragment(3, i, MAX_FRAME_FRAGMENTS));
+        TEST_ASSERT_EQUAL(i == MAX_FRAME_FRAGMENTS - 1, assembler->finish_fragment());
+    }
+}
+
+// RFC 1982: ids up to 32767 ahead are newer, including across the wrap.
+void test_older_ids_are_stale()
+{
+    TEST_ASSERT_TRUE(fragment(100, 0, 2, 1));
+    TEST_ASSERT_FALSE(fragment(99, 0, 2, 1));
+    TEST_ASSERT_FALSE(fragment(100 - 32768, 0, 2, 1));
+    TEST_ASSERT_EQUAL(2, rejected());
+    TEST_ASSERT_EQUAL(0, dropped());
+
+    // The frame in progress survived the stale fragments.
+    TEST_ASSERT_TRUE(fragment(100, 1, 2, 1));
+    TEST_ASSERT_TRUE(assembler->finish_fragment());
+}
+
+void test_ids_wrap_around()
+{
+    TEST_ASSERT_TRUE(fragment(0xFFFF, 0, 1, 1));
+    TEST_ASSERT_TRUE(assembler->finish_fragment());
+
+    TEST_ASSERT_TRUE(fragment(0x0000, 0, 1, 2));
+    TEST_ASSERT_TRUE(assembler->finish_fragment());
+    TEST_ASSERT_FALSE(fragment(0xFFFF, 0, 1, 3));
+    TEST_ASSERT_EQUAL(2, red(0));
+}
+
+// A newer id abandons the frame in progress; its pixels never show.
+void test_newer_id_drops_the_frame_in_progress()
+{
+    TEST_ASSERT_TRUE(fragment(1, 0, 2, 10));
+    TEST_ASSERT_TRUE(fragment(2, 1, 2, 20));
+    TEST_ASSERT_EQUAL(1, dropped());
+
+    TEST_ASSERT_TRUE(fragment(2, 0, 2, 30));
+    TEST_ASSERT_TRUE(assembler->finish_fragment());
+    TEST_ASSERT_EQUAL(30, red(0));
+    TEST_ASSERT_EQUAL(20, red(1));
+}
+
+// Fragments of a frame that was already presented are late, not a new frame.
+void test_presented_id_is_not_reassembled()
+{
+    TEST_ASSERT_TRUE(fragment(5, 0, 1, 1));
+    TEST_ASSERT_TRUE(assembler->finish_fragment());
+    TEST_ASSERT_FALSE(fragment(5, 0, 1, 2));
+    TEST_ASSERT_EQUAL(1, red(0));
+}
+
+void test_commit_presents_what_arrived()
+{
+    TEST_ASSERT_TRUE(fragment(1, 0, MAX_FRAME_FRAGMENTS, 10));
+    TEST_ASSERT_TRUE(fragment(1, 2, MAX_FRAME_FRAGMENTS, 30));
+    TEST_ASSERT_FALSE(assembler->finish_fragment());
+
+    TEST_ASSERT_TRUE(assembler->commit(1));
+    TEST_ASSERT_EQUAL(10, red(0));
+    TEST_ASSERT_EQUAL(0, red(1));
+    TEST_ASSERT_EQUAL(30, red(2));
+    TEST_ASSERT_EQUAL(1, assembler->get_stats().frames_committed.load());
+}
+
+void test_commit_after_completion_is_ignored()
+{
+    TEST_ASSERT_TRUE(fragment(1, 0, 1, 10));
+    TEST_ASSERT_TRUE(assembler->finish_fragment());
+
+    TEST_ASSERT_FALSE(assembler->commit(1));
+    TEST_ASSERT_EQUAL(0, rejected());
+    TEST_ASSERT_EQUAL(0, assembler->get_stats().frames_committed.load());
+}
+
+void test_commit_of_unknown_frame_is_rejected()
+{
+    TEST_ASSERT_FALSE(assembler->commit(1));
+    TEST_ASSERT_TRUE(fragment(2, 0, 2, 10));
+    TEST_ASSERT_FALSE(assembler->commit(3));
+    TEST_ASSERT_EQUAL(2, rejected());
+    TEST_ASSERT_EQUAL(0, red(0));
+}
+
+void test_stalled_frame_expires()
+{
+    TEST_ASSERT_TRUE(fragment(1, 0, 2, 10));
+
+    assembler->expire(esp_timer_get_time() + FRAME_TIMEOUT_US / 2);
+    TEST_ASSERT_EQUAL(0, dropped());
+
+    assembler->expire(esp_timer_get_time() + FRAME_TIMEOUT_US + 1);
+    TEST_ASSERT_EQUAL(1, dropped());
+    TEST_ASSERT_FALSE(assembler->commit(1));
+    TEST_ASSERT_EQUAL(0, red(0));
+}
+
+// After a quiet spell any id starts a new sequence, so a restarted sender
+// counting from 0 again is not locked out.
+void test_quiet_sender_may_restart_its_ids()
+{
+    TEST_ASSERT_TRUE(fragment(1000, 0, 1, 1));
+    TEST_ASSERT_TRUE(assembler->finish_fragment());
+    TEST_ASSERT_FALSE(fragment(0, 0, 1, 2));
+
+    std::this_thread::sleep_for(std::chrono::microseconds(FRAME_TIMEOUT_US + 10 * 1000));
+
+    TEST_ASSERT_TRUE(fragment(0, 0, 1, 2));
+    TEST_ASSERT_TRUE(assembler->finish_fragment());
+    TEST_ASSERT_EQUAL(2, red(0));
+}
+
+// Writes from outside the assembler land in the next frame and in the one
+// being assembled.
+void test_write_through_reaches_both_buffers()
+{
+    TEST_ASSERT_TRUE(fragment(1, 0, 2, 10));
+    assembler->write_through(3, 40, 40, 40);
+    TEST_ASSERT_EQUAL(40, red(3));
+
+    TEST_ASSERT_TRUE(fragment(1, 1, 2, 20));
+    TEST_ASSERT_TRUE(assembler->finish_fragment());
+    TEST_ASSERT_EQUAL(40, red(3));
+}
+
+int main(int, char **)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_frame_presents_once_every_fragment_arrived);
+    RUN_TEST(test_untouched_leds_keep_their_colour);
+    RUN_TEST(test_duplicate_fragment_is_rejected);
+    RUN_TEST(test_bad_headers_are_rejected);
+    RUN_TEST(test_largest_fragment_count_completes);
+    RUN_TEST(test_older_ids_are_stale);
+    RUN_TEST(test_ids_wrap_around);
+    RUN_TEST(test_newer_id_drops_the_frame_in_progress);
+    RUN_TEST(test_presented_id_is_not_reassembled);
+    RUN_TEST(test_commit_presents_what_arrived);
+    RUN_TEST(test_commit_after_completion_is_ignored);
+    RUN_TEST(test_commit_of_unknown_frame_is_rejected);
+    RUN_TEST(test_stalled_frame_expires);
+    RUN_TEST(test_quiet_sender_may_restart_its_ids);
+    RUN_TEST(test_write_through_reaches_both_buffers);
+    return UNITY_END();
+}
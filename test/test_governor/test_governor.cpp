@@ -0,0 +1,115 @@
+#include "drak/governor.hpp"
+#include <unity.h>
+
+using Governor = RefreshGovernor;
+
+constexpr uint32_t TICK_US = portTICK_PERIOD_MS * 1000;
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_starts_at_full_rate()
+{
+    Governor g;
+
+    TEST_ASSERT_EQUAL_UINT32(Governor::min_interval_us, g.get_interval_us());
+    TEST_ASSERT_EQUAL_UINT32(0, g.get_pass_delay_ms());
+}
+
+// The floor is what the strip needs per frame: the frame on the wire plus
+// the reset gap. The ceiling is the idle rate.
+void test_floor_and_ceiling()
+{
+    TEST_ASSERT_EQUAL_UINT32(BoardStrip::frame_wire_us + BoardStrip::model::reset_us, Governor::min_interval_us);
+    TEST_ASSERT_EQUAL_UINT32(1000 * 1000 / GOVERNOR_IDLE_FPS, Governor::max_interval_us);
+}
+
+// Every unchanged pass doubles the interval; the last step is cut short at
+// the ceiling, where it then stays.
+void test_unchanged_passes_double_up_to_the_ceiling()
+{
+    Governor g;
+    uint32_t expected = Governor::min_interval_us;
+
+    while (expected < Governor::max_interval_us)
+    {
+        g.update(false);
+        expected = expected * 2 < Governor::max_interval_us ? expected * 2 : Governor::max_interval_us;
+        TEST_ASSERT_EQUAL_UINT32(expected, g.get_interval_us());
+    }
+
+    for (int i = 0; i < 10; i++)
+        g.update(false);
+
+    TEST_ASSERT_EQUAL_UINT32(Governor::max_interval_us, g.get_interval_us());
+}
+
+// One change snaps back to full rate, however far the interval had backed off.
+void test_change_snaps_back_to_the_floor()
+{
+    Governor g;
+
+    g.update(false);
+    g.update(true);
+    TEST_ASSERT_EQUAL_UINT32(Governor::min_interval_us, g.get_interval_us());
+    TEST_ASSERT_EQUAL_UINT32(0, g.get_pass_delay_ms());
+
+    for (int i = 0; i < 20; i++)
+        g.update(false);
+
+    g.update(true);
+    TEST_ASSERT_EQUAL_UINT32(Governor::min_interval_us, g.get_interval_us());
+
+    // Staying at the floor while passes keep changing.
+    g.update(true);
+    TEST_ASSERT_EQUAL_UINT32(Governor::min_interval_us, g.get_interval_us());
+}
+
+// Off the floor, the delay is the interval rounded up to whole ticks: never
+// shorter than asked, never a tick longer, and at least one tick.
+void test_pass_delay_rounds_up_to_ticks()
+{
+    Governor g;
+
+    while (g.get_interval_us() < Governor::max_interval_us)
+    {
+        g.update(false);
+
+        const uint32_t delay_ms = g.get_pass_delay_ms();
+
+        TEST_ASSERT_EQUAL_UINT32(0, delay_ms % portTICK_PERIOD_MS);
+        TEST_ASSERT_GREATER_OR_EQUAL(portTICK_PERIOD_MS, delay_ms);
+        TEST_ASSERT_GREATER_OR_EQUAL(g.get_interval_us(), delay_ms * 1000);
+        TEST_ASSERT_LESS_THAN(g.get_interval_us() + TICK_US, delay_ms * 1000);
+    }
+
+    TEST_ASSERT_EQUAL_UINT32((Governor::max_interval_us + TICK_US - 1) / TICK_US * portTICK_PERIOD_MS,
+                             g.get_pass_delay_ms());
+}
+
+// The delay is whole ticks, so it sleeps exactly that many.
+void test_pass_delay_converts_to_whole_ticks()
+{
+    Governor g;
+
+    for (int i = 0; i < 20; i++)
+    {
+        g.update(false);
+
+        const uint32_t delay_ms = g.get_pass_delay_ms();
+        TEST_ASSERT_EQUAL_UINT32(delay_ms, pdMS_TO_TICKS(delay_ms) * portTICK_PERIOD_MS);
+    }
+}
+
+int main(int, char **)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_starts_at_full_rate);
+    RUN_TEST(test_floor_and_ceiling);
+    RUN_TEST(test_unchanged_passes_double_up_to_the_ceiling);
+    RUN_TEST(test_change_snaps_back_to_the_floor);
+    RUN_TEST(test_pass_delay_rounds_up_to_ticks);
+    RUN_TEST(test_pass_delay_converts_to_whole_ticks);
+    return UNITY_END();
+}
@@ -0,0 +1,130 @@
+#include "drak/hex.hpp"
+#include <cstdlib>
+#include <string>
+#include <unity.h>
+
+constexpr uint32_t RANDOM_RECORDS = 1000000;
+constexpr char DIGITS[] = "0123456789abcdefABCDEF";
+
+// Straightforward per-character reference; -1 for anything that is not hex.
+static int reference_nibble(uint8_t c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    return -1;
+}
+
+static uint64_t rng_state = 0x9E3779B97F4A7C15ULL;
+
+static uint64_t next_random()
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+// Checks the decoder against the reference. Nibbles are only compared for
+// valid input; for invalid input only the verdict is defined.
+static bool matches_reference(const char *record)
+{
+    uint8_t expected[16], nibbles[16];
+    bool valid = true;
+
+    for (int i = 0; i < 16; i++)
+    {
+        const int n = reference_nibble(record[i]);
+        valid = valid && n >= 0;
+        expected[i] = n;
+    }
+
+    if (hex_decode16(record, nibbles) != valid)
+        return false;
+
+    return !valid || std::memcmp(nibbles, expected, 16) == 0;
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+// Every byte value at every position of an otherwise valid record.
+void test_every_byte_at_every_position()
+{
+    char record[16];
+    uint32_t mismatches = 0;
+
+    for (int pos = 0; pos < 16; pos++)
+    {
+        for (int c = 0; c < 256; c++)
+        {
+            for (int i = 0; i < 16; i++)
+                record[i] = DIGITS[(i * 5 + c) % (sizeof(DIGITS) - 1)];
+
+            record[pos] = char(c);
+            mismatches += !matches_reference(record);
+        }
+    }
+
+    TEST_ASSERT_EQUAL_UINT32(0, mismatches);
+}
+
+// Mostly hex digits with the odd arbitrary byte, so both verdicts occur often.
+void test_random_records()
+{
+    char record[16];
+    uint8_t nibbles[16];
+    uint32_t mismatches = 0;
+    uint32_t valid = 0;
+
+    for (uint32_t n = 0; n < RANDOM_RECORDS; n++)
+    {
+        for (auto &c : record)
+        {
+            const uint64_t r = next_random();
+            c = r % 64 == 0 ? char(r >> 8) : DIGITS[(r >> 8) % (sizeof(DIGITS) - 1)];
+        }
+
+        mismatches += !matches_reference(record);
+        valid += hex_decode16(record, nibbles);
+    }
+
+    TEST_ASSERT_EQUAL_UINT32(0, mismatches);
+    TEST_ASSERT_GREATER_THAN(RANDOM_RECORDS / 4, valid);
+    TEST_ASSERT_GREATER_THAN(valid, RANDOM_RECORDS);
+}
+
+// Header fields must parse exactly as strtol did before.
+void test_parse_matches_strtol()
+{
+    for (int len = 1; len <= 8; len++)
+    {
+        for (int n = 0; n < 10000; n++)
+        {
+            std::string field;
+            for (int i = 0; i < len; i++)
+                field += DIGITS[next_random() % (sizeof(DIGITS) - 1)];
+
+            uint32_t value;
+            TEST_ASSERT_TRUE(hex_parse(field.data(), len, value));
+            TEST_ASSERT_EQUAL_UINT32(uint32_t(std::strtoul(field.c_str(), nullptr, 16)), value);
+        }
+    }
+
+    uint32_t value;
+    TEST_ASSERT_FALSE(hex_parse("12g4", 4, value));
+    TEST_ASSERT_FALSE(hex_parse("-1", 2, value));
+}
+
+int main(int, char **)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_every_byte_at_every_position);
+    RUN_TEST(test_random_records);
+    RUN_TEST(test_parse_matches_strtol);
+    return UNITY_END();
+}
@@ -0,0 +1,221 @@
+#include "drak/layout.hpp"
+#include <unity.h>
+
+// Expected mappings are written out by hand from the wiring, as seen from
+// the front with LED 0 at the top left.
+
+void setUp() {}
+
+void tearDown() {}
+
+// Physical LED at logical cell (x, y) of the layout's current grid.
+template <typename L>
+static uint16_t at(const L &layout, int x, int y)
+{
+    return layout.physical(y * layout.get_width() + x);
+}
+
+void test_default_is_one_row()
+{
+    Layout<8> layout;
+
+    TEST_ASSERT_EQUAL(8, layout.get_width());
+    TEST_ASSERT_EQUAL(1, layout.get_height());
+
+    for (int i = 0; i < 8; i++)
+        TEST_ASSERT_EQUAL(i, layout.physical(i));
+
+    TEST_ASSERT_EQUAL(LAYOUT_UNMAPPED, layout.physical(8));
+    TEST_ASSERT_EQUAL(LAYOUT_UNMAPPED, layout.physical(-1));
+}
+
+void test_rows()
+{
+    Layout<12> layout;
+    TEST_ASSERT_TRUE(layout.set_matrix(4, 3, 0).is_ok());
+
+    TEST_ASSERT_EQUAL(0, at(layout, 0, 0));
+    TEST_ASSERT_EQUAL(3, at(layout, 3, 0));
+    TEST_ASSERT_EQUAL(4, at(layout, 0, 1));
+    TEST_ASSERT_EQUAL(11, at(layout, 3, 2));
+}
+
+// 0 1 2 3
+// 7 6 5 4
+// 8 9 . .
+void test_serpentine_rows()
+{
+    Layout<12> layout;
+    TEST_ASSERT_TRUE(layout.set_matrix(4, 3, LAYOUT_SERPENTINE).is_ok());
+
+    TEST_ASSERT_EQUAL(3, at(layout, 3, 0));
+    TEST_ASSERT_EQUAL(7, at(layout, 0, 1));
+    TEST_ASSERT_EQUAL(4, at(layout, 3, 1));
+    TEST_ASSERT_EQUAL(8, at(layout, 0, 2));
+    TEST_ASSERT_EQUAL(11, at(layout, 3, 2));
+}
+
+// 0 5 6
+// 1 4 7
+// 2 3 8
+void test_serpentine_columns()
+{
+    Layout<9> layout;
+    TEST_ASSERT_TRUE(layout.set_matrix(3, 3, LAYOUT_SERPENTINE | LAYOUT_COLUMNS).is_ok());
+
+    TEST_ASSERT_EQUAL(2, at(layout, 0, 2));
+    TEST_ASSERT_EQUAL(5, at(layout, 1, 0));
+    TEST_ASSERT_EQUAL(3, at(layout, 1, 2));
+    TEST_ASSERT_EQUAL(6, at(layout, 2, 0));
+    TEST_ASSERT_EQUAL(8, at(layout, 2, 2));
+}
+
+void test_flips()
+{
+    Layout<6> layout;
+
+    // 2 1 0
+    // 5 4 3
+    TEST_ASSERT_TRUE(layout.set_matrix(3, 2, LAYOUT_FLIP_X).is_ok());
+    TEST_ASSERT_EQUAL(2, at(layout, 0, 0));
+    TEST_ASSERT_EQUAL(3, at(layout, 2, 1));
+
+    // 3 4 5
+    // 0 1 2
+    TEST_ASSERT_TRUE(layout.set_matrix(3, 2, LAYOUT_FLIP_Y).is_ok());
+    TEST_ASSERT_EQUAL(3, at(layout, 0, 0));
+    TEST_ASSERT_EQUAL(2, at(layout, 2, 1));
+}
+
+// A 4 x 2 matrix wired in rows,
+//   0 1 2 3
+//   4 5 6 7
+// seen after each number of clockwise quarter turns.
+void test_rotations()
+{
+    Layout<8> layout;
+
+    // 4 0
+    // 5 1
+    // 6 2
+    // 7 3
+    TEST_ASSERT_TRUE(layout.set_matrix(4, 2, 1 << 4).is_ok());
+    TEST_ASSERT_EQUAL(2, layout.get_width());
+    TEST_ASSERT_EQUAL(4, layout.get_height());
+    TEST_ASSERT_EQUAL(4, at(layout, 0, 0));
+    TEST_ASSERT_EQUAL(0, at(layout, 1, 0));
+    TEST_ASSERT_EQUAL(3, at(layout, 1, 3));
+
+    // 7 6 5 4
+    // 3 2 1 0
+    TEST_ASSERT_TRUE(layout.set_matrix(4, 2, 2 << 4).is_ok());
+    TEST_ASSERT_EQUAL(4, layout.get_width());
+    TEST_ASSERT_EQUAL(2, layout.get_height());
+    TEST_ASSERT_EQUAL(7, at(layout, 0, 0));
+    TEST_ASSERT_EQUAL(0, at(layout, 3, 1));
+
+    // 3 7
+    // 2 6
+    // 1 5
+    // 0 4
+    TEST_ASSERT_TRUE(layout.set_matrix(4, 2, 3 << 4).is_ok());
+    TEST_ASSERT_EQUAL(2, layout.get_width());
+    TEST_ASSERT_EQUAL(3, at(layout, 0, 0));
+    TEST_ASSERT_EQUAL(0, at(layout, 0, 3));
+    TEST_ASSERT_EQUAL(4, at(layout, 1, 3));
+}
+
+// Wiring is applied before the turn: serpentine, then a half turn.
+//   0 1 2      3 4 5
+//   5 4 3  ->  2 1 0
+void test_serpentine_with_rotation()
+{
+    Layout<6> layout;
+    TEST_ASSERT_TRUE(layout.set_matrix(3, 2, LAYOUT_SERPENTINE | 2 << 4).is_ok());
+
+    TEST_ASSERT_EQUAL(3, at(layout, 0, 0));
+    TEST_ASSERT_EQUAL(5, at(layout, 2, 0));
+    TEST_ASSERT_EQUAL(0, at(layout, 2, 1));
+}
+
+// More cells than LEDs: the strip ends part way through the grid.
+void test_matrix_larger_than_the_strip()
+{
+    Layout<60> layout;
+    TEST_ASSERT_TRUE(layout.set_matrix(16, 16, 0).is_ok());
+
+    TEST_ASSERT_EQUAL(59, at(layout, 11, 3));
+    TEST_ASSERT_EQUAL(LAYOUT_UNMAPPED, at(layout, 12, 3));
+    TEST_ASSERT_EQUAL(LAYOUT_UNMAPPED, at(layout, 15, 15));
+}
+
+// An irregular fixture: 60 LEDs scattered over a 16 x 16 grid, LED p at
+// cell (p % 8 * 2, p / 8 * 2). Cells in between address nothing.
+void test_sparse_table()
+{
+    Layout<60> layout;
+    uint8_t table[60 * 2];
+
+    for (int p = 0; p < 60; p++)
+    {
+        const uint16_t logical = (p / 8 * 2) * 16 + p % 8 * 2;
+        table[p * 2] = logical & 0xFF;
+        table[p * 2 + 1] = logical >> 8;
+    }
+
+    TEST_ASSERT_TRUE(layout.set_table(16, 16, table, 60).is_ok());
+    TEST_ASSERT_EQUAL(16, layout.get_width());
+    TEST_ASSERT_EQUAL(16, layout.get_height());
+
+    TEST_ASSERT_EQUAL(0, at(layout, 0, 0));
+    TEST_ASSERT_EQUAL(LAYOUT_UNMAPPED, at(layout, 1, 0));
+    TEST_ASSERT_EQUAL(9, at(layout, 2, 2));
+    TEST_ASSERT_EQUAL(59, at(layout, 6, 14));
+    TEST_ASSERT_EQUAL(LAYOUT_UNMAPPED, at(layout, 15, 15));
+}
+
+void test_table_skips_unmapped_leds()
+{
+    Layout<3> layout;
+    const uint8_t table[] = {2, 0, 0xFF, 0xFF, 0, 0};
+
+    TEST_ASSERT_TRUE(layout.set_table(3, 1, table, 3).is_ok());
+    TEST_ASSERT_EQUAL(2, layout.physical(0));
+    TEST_ASSERT_EQUAL(LAYOUT_UNMAPPED, layout.physical(1));
+    TEST_ASSERT_EQUAL(0, layout.physical(2));
+}
+
+// A rejected layout leaves the current one in place.
+void test_bad_layouts_are_rejected()
+{
+    Layout<4> layout;
+    const uint8_t outside[] = {0, 0, 4, 0};
+    const uint8_t too_many[10] = {};
+
+    TEST_ASSERT_EQUAL(Layout<4>::INVALID_SIZE, layout.set_matrix(0, 4, 0).unwrap_err());
+    TEST_ASSERT_EQUAL(Layout<4>::INVALID_SIZE, layout.set_matrix(64, 64, 0).unwrap_err());
+    TEST_ASSERT_EQUAL(Layout<4>::INVALID_SIZE, layout.set_matrix(65535, 65535, 0).unwrap_err());
+    TEST_ASSERT_EQUAL(Layout<4>::INVALID_SIZE, layout.set_table(4, 1, too_many, 5).unwrap_err());
+    TEST_ASSERT_EQUAL(Layout<4>::INVALID_TABLE, layout.set_table(2, 2, outside, 2).unwrap_err());
+
+    TEST_ASSERT_EQUAL(4, layout.get_width());
+    for (int i = 0; i < 4; i++)
+        TEST_ASSERT_EQUAL(i, layout.physical(i));
+}
+
+int main(int, char **)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_default_is_one_row);
+    RUN_TEST(test_rows);
+    RUN_TEST(test_serpentine_rows);
+    RUN_TEST(test_serpentine_columns);
+    RUN_TEST(test_flips);
+    RUN_TEST(test_rotations);
+    RUN_TEST(test_serpentine_with_rotation);
+    RUN_TEST(test_matrix_larger_than_the_strip);
+    RUN_TEST(test_sparse_table);
+    RUN_TEST(test_table_skips_unmapped_leds);
+    RUN_TEST(test_bad_layouts_are_rejected);
+    return UNITY_END();
+}
@@ -0,0 +1,482 @@
+// End to end on the host: UDP::Server, the pipeline and LightLangCompiler run
+// as on the device, over a loopback socket, with the FreeRTOS and RMT shims
+// from test/shim. A generator streams fragmented frames at a fixed rate and
+// the fake strip records what would have gone out on the wire.
+//
+// Defaults make a short run; for a soak, set any of
+//   LLC_SOAK_SECONDS (2), LLC_SOAK_RATE frames/s (200), LLC_SOAK_RECORDS
+//   per fragment (20), LLC_SOAK_PORT (38300, and the next port for control)
+// and run the suite, e.g. LLC_SOAK_SECONDS=3600 pio test -e native -f test_loopback
+
+#include "drak/alloc_guard.hpp"
+#include "drak/feedback.hpp"
+#include "drak/light_lang.hpp"
+#include "drak/metrics.hpp"
+#include "drak/pipeline.hpp"
+#include "drak/udp.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+#include <unity.h>
+#include <vector>
+
+Strip<BoardStrip> strip;
+Metrics metrics;
+AnimLibrary anim_library;
+LightLangCompiler llc;
+Pipeline pipeline(llc);
+Feedback feedback(pipeline);
+
+using Clock = std::chrono::steady_clock;
+
+constexpr int MAX_FRAGMENTS = 64;
+
+// Heap the firmware side may gain once warmed up, for glibc's own bookkeeping.
+constexpr int64_t HEAP_GROWTH_LIMIT = 4096;
+
+struct Options
+{
+    double seconds = 2;
+    double rate = 200;
+    int records = 20;
+    uint16_t port = 38300;
+};
+
+struct Acks
+{
+    uint64_t job = 0;
+    uint64_t dropped = 0;
+    uint64_t other = 0;
+};
+
+// Per frame id: when its first fragment was sent, 0 once it reached the wire.
+static std::atomic<int64_t> sent_at[65536];
+static std::vector<uint32_t> latency_us;
+static std::atomic<size_t> latency_count{0};
+
+static Options opt;
+static int sock = -1;
+static sockaddr_in device{};
+
+static double env_or(const char *name, double fallback)
+{
+    const char *v = std::getenv(name);
+    return v != nullptr ? std::atof(v) : fallback;
+}
+
+void on_socket_message(UDP::Server *server, int endpoint, std::string_view data, const char *sender_ip,
+                       uint16_t sender_port)
+{
+    if (feedback.answer_discovery(server, endpoint, data, sender_ip, sender_port))
+        return;
+
+    const auto result = pipeline.submit(data);
+    feedback.acknowledge(server, endpoint, data, sender_ip, sender_port, result);
+}
+
+void on_socket_poll(UDP::Server *) { llc.poll(); }
+
+// Runs on the render task. Pixel 0 carries the frame id in red and green.
+static void on_transmit(const uint8_t *data, size_t)
+{
+    using Order = BoardStrip::order;
+    const uint16_t id = data[Order::r] | data[Order::g] << 8;
+    const int64_t sent = sent_at[id].exchange(0);
+
+    if (sent == 0)
+        return;
+
+    const size_t i = latency_count.fetch_add(1);
+    if (i < latency_us.size())
+        latency_us[i] = esp_timer_get_time() - sent;
+}
+
+static void put_hex(char *&out, uint32_t v, int digits)
+{
+    static const char *hex = "0123456789abcdef";
+    for (int i = digits - 1; i >= 0; i--)
+        *out++ = hex[(v >> (i * 4)) & 0xF];
+}
+
+static void send_datagram(const char *data, size_t len, uint16_t port = 0)
+{
+    sockaddr_in to = device;
+
+    if (port != 0)
+        to.sin_port = htons(port);
+
+    sendto(sock, data, len, 0, reinterpret_cast<const sockaddr *>(&to), sizeof(to));
+}
+
+// Fragments declare the maximum count, so each frame is presented by its commit.
+// Returns the number of datagrams sent.
+static int send_frame(uint16_t id, const uint8_t *rgb)
+{
+    char packet[LL_FRAGMENT_HEADER_SIZE + LL_RECORD_SIZE * LED_COUNT];
+    int sent = 0;
+
+    sent_at[id].store(esp_timer_get_time());
+
+    for (int first = 0, index = 0; first < LED_COUNT; first += opt.records, index++, sent++)
+    {
+        char *p = packet;
+        *p++ = LL_FRAGMENT;
+        put_hex(p, id, 4);
+        put_hex(p, index, 2);
+        put_hex(p, MAX_FRAGMENTS, 2);
+
+        for (int i = first; i < std::min(LED_COUNT, first + opt.records); i++)
+        {
+            put_hex(p, i, 3);
+            put_hex(p, rgb[i * 3 + 0], 2);
+            put_hex(p, rgb[i * 3 + 1], 2);
+            put_hex(p, rgb[i * 3 + 2], 2);
+            put_hex(p, 0, 7);
+        }
+
+        send_datagram(packet, p - packet);
+    }
+
+    char commit[LL_COMMIT_SIZE];
+    char *p = commit;
+    *p++ = LL_COMMIT;
+    put_hex(p, id, 4);
+    send_datagram(commit, sizeof(commit));
+
+    return sent + 1;
+}
+
+// Drains acks of commits; returns true if `wanted` was queued.
+static bool drain_acks(Acks &acks, int wanted = -1)
+{
+    uint8_t buf[64];
+    ssize_t n;
+    bool found = false;
+
+    while ((n = recv(sock, buf, sizeof(buf), MSG_DONTWAIT)) > 0)
+    {
+        if (buf[0] != FB_ACK || n < 2 + LL_COMMIT_SIZE || buf[2] != LL_COMMIT)
+            continue;
+
+        if (buf[1] == LL_JOB)
+            acks.job++;
+        else if (buf[1] == LL_DROPPED)
+            acks.dropped++;
+        else
+            acks.other++;
+
+        int id = 0;
+        for (int i = 3; i < 3 + 4; i++)
+            id = id << 4 | (buf[i] <= '9' ? buf[i] - '0' : (buf[i] | 0x20) - 'a' + 10);
+
+        found = found || (buf[1] == LL_JOB && id == wanted);
+    }
+
+    return found;
+}
+
+static void random_frame(std::mt19937 &rng, uint16_t id, uint8_t *rgb)
+{
+    for (int i = 0; i < LED_COUNT * 3; i++)
+        rgb[i] = rng();
+
+    rgb[0] = id & 0xFF;
+    rgb[1] = id >> 8;
+    rgb[2] = 0;
+}
+
+// What Strip puts on the wire for an RGB frame.
+static void expected_wire(const uint8_t *rgb, uint8_t *wire)
+{
+    using Order = BoardStrip::order;
+
+    for (int i = 0; i < LED_COUNT; i++, rgb += 3, wire += Order::channels)
+    {
+        uint8_t w = 0;
+
+        if constexpr (Order::w >= 0)
+        {
+            w = std::min(rgb[0], std::min(rgb[1], rgb[2]));
+            wire[Order::w] = w;
+        }
+
+        wire[Order::r] = rgb[0] - w;
+        wire[Order::g] = rgb[1] - w;
+        wire[Order::b] = rgb[2] - w;
+    }
+}
+
+static uint32_t percentile(std::vector<uint32_t> &v, double q)
+{
+    if (v.empty())
+        return 0;
+
+    const size_t i = std::min(v.size() - 1, size_t(q * v.size()));
+    std::nth_element(v.begin(), v.begin() + i, v.end());
+    return v[i];
+}
+
+// Resends a fresh frame until the pipeline queues it, then waits for it on
+// the wire. `failure` says which step did not happen.
+static bool deliver_final_frame(std::mt19937 &rng, uint16_t &id, Acks &acks, const char *&failure)
+{
+    uint8_t rgb[LED_COUNT * 3];
+    uint8_t expected[BoardStrip::frame_bytes];
+    uint8_t actual[BoardStrip::frame_bytes];
+    bool queued = false;
+
+    for (int attempt = 0; attempt < 20 && !queued; attempt++, id++)
+    {
+        random_frame(rng, id, rgb);
+        send_frame(id, rgb);
+
+        for (int i = 0; i < 20 && !queued; i++)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            queued = drain_acks(acks, id);
+        }
+    }
+
+    failure = "final frame never queued";
+    if (!queued)
+        return false;
+
+    expected_wire(rgb, expected);
+
+    for (int i = 0; i < 100; i++)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+        if (shim_rmt_recorder.copy_last(actual, sizeof(actual)) == sizeof(actual) &&
+            std::memcmp(actual, expected, sizeof(actual)) == 0)
+            return true;
+    }
+
+    failure = "final frame on the wire differs from what was sent";
+    return false;
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+// Pings `port` until a discovery reply comes back into `reply`; returns the
+// port it came from, 0 if none did.
+static uint16_t discover(uint16_t port, uint8_t *reply)
+{
+    for (int attempt = 0; attempt < 50; attempt++)
+    {
+        send_datagram(&FB_DISCOVER, 1, port);
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+        sockaddr_in from{};
+        socklen_t from_len = sizeof(from);
+        const ssize_t n =
+            recvfrom(sock, reply, 1 + FB_STATUS_SIZE, MSG_DONTWAIT, reinterpret_cast<sockaddr *>(&from), &from_len);
+
+        if (n == 1 + FB_STATUS_SIZE && reply[0] == FB_DISCOVER_REPLY)
+            return ntohs(from.sin_port);
+    }
+
+    return 0;
+}
+
+void test_discovery_reply()
+{
+    uint8_t reply[1 + FB_STATUS_SIZE];
+
+    TEST_ASSERT_EQUAL(opt.port, discover(opt.port, reply));
+    TEST_ASSERT_EQUAL(FB_VERSION, reply[1]);
+    TEST_ASSERT_EQUAL(LED_COUNT, reply[2] | reply[3] << 8);
+}
+
+void test_reply_leaves_from_the_receiving_endpoint()
+{
+    uint8_t reply[1 + FB_STATUS_SIZE];
+
+    TEST_ASSERT_EQUAL(opt.port + 1, discover(opt.port + 1, reply));
+}
+
+// Streams frames for the configured time, then checks the last one reached
+// the strip intact and that the receive and render paths did not grow the heap.
+void test_soak_over_loopback()
+{
+    std::mt19937 rng(1);
+    uint8_t rgb[LED_COUNT * 3];
+    Acks acks;
+    uint16_t id = 0;
+    uint64_t packets_sent = 0;
+
+    latency_us.assign(size_t(opt.rate * opt.seconds * 2) + 1024, 0);
+    shim_rmt_recorder.on_transmit = &on_transmit;
+
+    // Warm-up: the first frames through every path do the one-off allocations.
+    for (int i = 0; i < 50; i++, id++)
+    {
+        random_frame(rng, id, rgb);
+        send_frame(id, rgb);
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    drain_acks(acks);
+    latency_count = 0;
+    acks = {};
+
+    const int64_t heap_before = shim_heap_used();
+    const uint32_t received_before = metrics.get_packets_received();
+    const uint32_t rendered_before = metrics.get_frames_rendered();
+
+    const auto period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / opt.rate));
+    const auto started = Clock::now();
+    const auto until = started + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(opt.seconds));
+
+    for (auto next = started; next < until; id++)
+    {
+        random_frame(rng, id, rgb);
+        packets_sent += send_frame(id, rgb);
+        next += period;
+
+        drain_acks(acks);
+        std::this_thread::sleep_until(next);
+    }
+
+    const double elapsed = std::chrono::duration<double>(Clock::now() - started).count();
+    const uint32_t received = metrics.get_packets_received() - received_before;
+    const uint32_t rendered = metrics.get_frames_rendered() - rendered_before;
+
+    const char *failure = nullptr;
+    const bool delivered = deliver_final_frame(rng, id, acks, failure);
+
+    const int64_t heap_growth = int64_t(shim_heap_used()) - heap_before;
+    shim_rmt_recorder.on_transmit = nullptr;
+
+    std::vector<uint32_t> latencies(latency_us.begin(),
+                                    latency_us.begin() + std::min(latency_count.load(), latency_us.size()));
+    const uint32_t p50 = percentile(latencies, 0.5);
+    const uint32_t p90 = percentile(latencies, 0.9);
+    const uint32_t p99 = percentile(latencies, 0.99);
+    const uint32_t max = percentile(latencies, 1.0);
+
+    char line[256];
+    snprintf(line, sizeof(line),
+             "%.1f s: sent %.0f pkt/s, received %.0f pkt/s, rendered %.1f fps; acks %" PRIu64 " queued, %" PRIu64
+             " dropped, %" PRIu64 " other",
+             elapsed, packets_sent / elapsed, received / elapsed, rendered / elapsed, acks.job, acks.dropped,
+             acks.other);
+    TEST_MESSAGE(line);
+    snprintf(line, sizeof(line),
+             "wire latency over %zu frames: p50 %" PRIu32 " p90 %" PRIu32 " p99 %" PRIu32 " max %" PRIu32
+             " us; heap %+" PRId64 " B",
+             latencies.size(), p50, p90, p99, max, heap_growth);
+    TEST_MESSAGE(line);
+
+    TEST_ASSERT_TRUE_MESSAGE(delivered, failure);
+    TEST_ASSERT_GREATER_THAN(0, rendered);
+    TEST_ASSERT_GREATER_THAN(0, latencies.size());
+    TEST_ASSERT_TRUE_MESSAGE(heap_growth <= HEAP_GROWTH_LIMIT, "heap grew during the run");
+}
+
+#ifdef LLC_STATIC_ALLOC
+// With the guard armed, as after boot on the device, every kind of packet
+// goes through receive, decode and render. Any C++ allocation on the way
+// aborts the suite. Runs last: the tasks and threads are all up by now, and
+// the soak has warmed every path.
+void test_armed_paths_stay_off_the_heap()
+{
+    std::mt19937 rng(2);
+    uint8_t rgb[LED_COUNT * 3];
+    Acks acks;
+    uint16_t id = 0x8000;
+    char packet[64];
+    char *p;
+
+    alloc_guard_arm();
+
+    for (int i = 0; i < 20; i++, id++)
+    {
+        random_frame(rng, id, rgb);
+        send_frame(id, rgb);
+    }
+
+    // Program: one record, no loop.
+    p = packet;
+    *p++ = '0';
+    put_hex(p, 1, 3);
+    put_hex(p, 0x102030, 6);
+    put_hex(p, 0, 7);
+    send_datagram(packet, p - packet);
+
+    // Transform, then back to the identity.
+    const uint8_t tint[LL_TRANSFORM_SIZE] = {LL_TRANSFORM, 0x00, 0x40, 0x00, 0x01, 0x00, 0x01, 255, 0, 0, 128};
+    const uint8_t identity[LL_TRANSFORM_SIZE] = {LL_TRANSFORM, 0, 0, 0x00, 0x01, 0x00, 0x01, 0, 0, 0, 0};
+    send_datagram(reinterpret_cast<const char *>(tint), sizeof(tint));
+
+    // Spectrum, with a beat.
+    const uint8_t spectrum[] = {LL_SPECTRUM, VIS_BARS, SPECTRUM_BEAT, 10, 200, 90, 30};
+    send_datagram(reinterpret_cast<const char *>(spectrum), sizeof(spectrum));
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    // A staged frame, shown by an immediate latch.
+    const char staging_on[LL_SYNC_SIZE] = {LL_SYNC, 1};
+    const char staging_off[LL_SYNC_SIZE] = {LL_SYNC, 0};
+    const char latch_now[LL_LATCH_SIZE] = {LL_LATCH};
+    const char beacon[LL_BEACON_SIZE] = {LL_BEACON, 0x40, 0x42, 0x0F};
+    send_datagram(beacon, sizeof(beacon));
+    send_datagram(staging_on, sizeof(staging_on));
+    random_frame(rng, id, rgb);
+    send_frame(id++, rgb);
+    send_datagram(latch_now, sizeof(latch_now));
+    send_datagram(staging_off, sizeof(staging_off));
+
+    send_datagram(reinterpret_cast<const char *>(identity), sizeof(identity));
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    const char *failure = nullptr;
+    TEST_ASSERT_TRUE_MESSAGE(deliver_final_frame(rng, id, acks, failure), failure);
+}
+#endif
+
+int main(int, char **)
+{
+    // mallinfo2(), behind shim_heap_used(), only sees the main arena.
+    mallopt(M_ARENA_MAX, 1);
+
+    opt.seconds = env_or("LLC_SOAK_SECONDS", opt.seconds);
+    opt.rate = env_or("LLC_SOAK_RATE", opt.rate);
+    opt.records = std::clamp(int(env_or("LLC_SOAK_RECORDS", opt.records)), 1, LED_COUNT);
+    opt.port = env_or("LLC_SOAK_PORT", opt.port);
+
+    strip.init();
+    pipeline.start();
+
+    UDP::Server server(opt.port);
+    const auto control = server.add_endpoint(opt.port + 1, 1);
+
+    server.add_on_message_listener(&on_socket_message);
+    server.add_on_message_listener(control.unwrap(), &on_socket_message);
+    server.add_on_poll_listener(&on_socket_poll);
+    server.start();
+
+    sock = socket(AF_INET, SOCK_DGRAM, 0);
+    device.sin_family = AF_INET;
+    device.sin_port = htons(opt.port);
+    device.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    UNITY_BEGIN();
+    RUN_TEST(test_discovery_reply);
+    RUN_TEST(test_reply_leaves_from_the_receiving_endpoint);
+    RUN_TEST(test_soak_over_loopback);
+#ifdef LLC_STATIC_ALLOC
+    RUN_TEST(test_armed_paths_stay_off_the_heap);
+#endif
+    const int failures = UNITY_END();
+
+    close(sock);
+    return failures;
+}
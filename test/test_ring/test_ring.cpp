@@ -0,0 +1,146 @@
+#include "drak/ring.hpp"
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <thread>
+#include <unity.h>
+
+constexpr uint32_t STRESS_ITEMS = 2000000;
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_full_and_empty()
+{
+    SpscRing<int, 4> ring;
+    int out;
+
+    TEST_ASSERT_NULL(ring.peek());
+    TEST_ASSERT_FALSE(ring.pop(out));
+
+    for (int i = 0; i < 4; i++)
+        TEST_ASSERT_TRUE(ring.push(i));
+
+    TEST_ASSERT_FALSE(ring.push(4));
+    TEST_ASSERT_NULL(ring.claim());
+    TEST_ASSERT_EQUAL(4, ring.size());
+    TEST_ASSERT_EQUAL(3, *ring.peek(3));
+    TEST_ASSERT_NULL(ring.peek(4));
+
+    for (int i = 0; i < 4; i++)
+    {
+        TEST_ASSERT_TRUE(ring.pop(out));
+        TEST_ASSERT_EQUAL(i, out);
+    }
+
+    TEST_ASSERT_EQUAL(0, ring.size());
+}
+
+// One producer and one consumer thread; every value must arrive exactly
+// once and in order. Also reports throughput.
+void test_two_threads_keep_order()
+{
+    static SpscRing<uint32_t, 4096> ring;
+    uint32_t mismatches = 0;
+
+    const auto started = std::chrono::steady_clock::now();
+
+    std::thread producer(
+        []
+        {
+            for (uint32_t i = 0; i < STRESS_ITEMS;)
+                if (ring.push(i))
+                    i++;
+        });
+
+    std::thread consumer(
+        [&mismatches]
+        {
+            uint32_t value;
+
+            for (uint32_t expected = 0; expected < STRESS_ITEMS;)
+            {
+                if (!ring.pop(value))
+                    continue;
+
+                if (value != expected)
+                    mismatches++;
+                expected++;
+            }
+        });
+
+    producer.join();
+    consumer.join();
+
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+    TEST_ASSERT_EQUAL_UINT32(0, mismatches);
+    TEST_ASSERT_EQUAL(0, ring.size());
+
+    char line[80];
+    snprintf(line, sizeof(line), "%" PRIu32 " items in %.3f s, %.1f M items/s", STRESS_ITEMS, seconds,
+             STRESS_ITEMS / seconds / 1e6);
+    TEST_MESSAGE(line);
+}
+
+// Slots filled in place must be fully visible to the consumer once published.
+void test_in_place_slots_are_published_whole()
+{
+    struct Job
+    {
+        uint32_t seq;
+        uint32_t payload[15];
+    };
+
+    static SpscRing<Job, 256> ring;
+    constexpr uint32_t jobs = 100000;
+    uint32_t torn = 0;
+
+    std::thread producer(
+        []
+        {
+            for (uint32_t i = 0; i < jobs;)
+            {
+                Job *slot = ring.claim();
+
+                if (slot == nullptr)
+                    continue;
+
+                slot->seq = i;
+                for (auto &p : slot->payload)
+                    p = i;
+
+                ring.publish();
+                i++;
+            }
+        });
+
+    for (uint32_t expected = 0; expected < jobs;)
+    {
+        const Job *job = ring.peek();
+
+        if (job == nullptr)
+            continue;
+
+        bool whole = job->seq == expected;
+        for (const auto &p : job->payload)
+            whole = whole && p == expected;
+
+        torn += !whole;
+        ring.consume();
+        expected++;
+    }
+
+    producer.join();
+    TEST_ASSERT_EQUAL_UINT32(0, torn);
+}
+
+int main(int, char **)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_full_and_empty);
+    RUN_TEST(test_two_threads_keep_order);
+    RUN_TEST(test_in_place_slots_are_published_whole);
+    return UNITY_END();
+}
@@ -0,0 +1,147 @@
+#include "drak/visualizer.hpp"
+#include <initializer_list>
+#include <unity.h>
+
+constexpr int N = 8;
+
+static Visualizer<N> *vis;
+static uint8_t rgb[N * 3];
+
+static SpectrumFrame spectrum(uint8_t mode, std::initializer_list<uint8_t> bands, uint8_t beat = 0)
+{
+    SpectrumFrame f = {};
+    f.mode = mode;
+    f.beat = beat;
+
+    for (const uint8_t b : bands)
+        f.bands[f.band_count++] = b;
+
+    return f;
+}
+
+static int brightness(int i) { return rgb[i * 3] + rgb[i * 3 + 1] + rgb[i * 3 + 2]; }
+
+static bool same_colour(int a, int b) { return std::memcmp(&rgb[a * 3], &rgb[b * 3], 3) == 0; }
+
+void setUp()
+{
+    vis = new Visualizer<N>;
+    std::memset(rgb, 0, sizeof(rgb));
+}
+
+void tearDown() { delete vis; }
+
+void test_nothing_drawn_before_the_first_frame()
+{
+    std::memset(rgb, 7, sizeof(rgb));
+    vis->draw(rgb);
+
+    TEST_ASSERT_EACH_EQUAL_UINT8(7, rgb, sizeof(rgb));
+    TEST_ASSERT_TRUE(vis->is_idle());
+}
+
+// Bands run along the strip, low to high, quiet to loud here.
+void test_bars_follow_the_bands()
+{
+    vis->update(spectrum(VIS_BARS, {0, 255}));
+    vis->draw(rgb);
+
+    TEST_ASSERT_EQUAL(0, brightness(0));
+    for (int i = 1; i < N; i++)
+        TEST_ASSERT_GREATER_OR_EQUAL(brightness(i - 1), brightness(i));
+
+    // The highest band is drawn in its own hue, far from red.
+    TEST_ASSERT_LESS_THAN(rgb[(N - 1) * 3 + 1], rgb[(N - 1) * 3]);
+}
+
+// Mirrored out from the middle: low bands at the centre, high at the ends.
+void test_center_is_mirrored()
+{
+    vis->update(spectrum(VIS_CENTER, {255, 0}));
+    vis->draw(rgb);
+
+    for (int i = 0; i < N / 2; i++)
+        TEST_ASSERT_TRUE(same_colour(i, N - 1 - i));
+
+    TEST_ASSERT_GREATER_THAN(brightness(0), brightness(N / 2));
+    TEST_ASSERT_EQUAL(0, brightness(0));
+}
+
+// One colour across the strip, in the loudest band's hue, at the mean level.
+void test_pulse_fills_the_strip()
+{
+    vis->update(spectrum(VIS_PULSE, {40, 200, 0, 0}));
+    vis->draw(rgb);
+
+    for (int i = 1; i < N; i++)
+        TEST_ASSERT_TRUE(same_colour(0, i));
+
+    // Band 1 of 4 is yellow-green: green leads.
+    TEST_ASSERT_GREATER_THAN(rgb[2], rgb[1]);
+    TEST_ASSERT_GREATER_THAN(0, brightness(0));
+}
+
+// A beat flashes the strip white in every mode, and the flash fades.
+void test_beat_flashes_every_mode()
+{
+    for (const uint8_t mode : {VIS_BARS, VIS_CENTER, VIS_PULSE})
+    {
+        Visualizer<N> v;
+
+        v.update(spectrum(mode, {0, 0}, SPECTRUM_BEAT));
+        v.draw(rgb);
+        TEST_ASSERT_EACH_EQUAL_UINT8(255, rgb, sizeof(rgb));
+
+        v.draw(rgb);
+        TEST_ASSERT_EQUAL(255 - VISUALIZER_FLASH_RELEASE, rgb[0]);
+    }
+}
+
+// Levels fall by VISUALIZER_RELEASE per drawn frame once frames stop, until
+// the strip is dark and the visualizer idle.
+void test_levels_decay_per_draw()
+{
+    vis->update(spectrum(VIS_BARS, {255, 255}));
+    vis->draw(rgb);
+    const int first = brightness(0);
+
+    vis->draw(rgb);
+    TEST_ASSERT_LESS_THAN(first, brightness(0));
+
+    int draws = 2;
+    while (!vis->is_idle() && draws < 100)
+    {
+        vis->draw(rgb);
+        draws++;
+    }
+
+    TEST_ASSERT_EQUAL((255 + VISUALIZER_RELEASE - 1) / VISUALIZER_RELEASE, draws);
+    vis->draw(rgb);
+    TEST_ASSERT_EACH_EQUAL_UINT8(0, rgb, sizeof(rgb));
+}
+
+// A quieter frame does not cut a level short; it keeps falling from the peak.
+void test_quieter_frame_does_not_lower_levels()
+{
+    vis->update(spectrum(VIS_PULSE, {200}));
+    vis->draw(rgb);
+    const int peak = brightness(0);
+
+    vis->update(spectrum(VIS_PULSE, {0}));
+    vis->draw(rgb);
+    TEST_ASSERT_GREATER_THAN(0, brightness(0));
+    TEST_ASSERT_LESS_THAN(peak, brightness(0));
+}
+
+int main(int, char **)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_nothing_drawn_before_the_first_frame);
+    RUN_TEST(test_bars_follow_the_bands);
+    RUN_TEST(test_center_is_mirrored);
+    RUN_TEST(test_pulse_fills_the_strip);
+    RUN_TEST(test_beat_flashes_every_mode);
+    RUN_TEST(test_levels_decay_per_draw);
+    RUN_TEST(test_quieter_frame_does_not_lower_levels);
+    return UNITY_END();
+}
@@ -0,0 +1,128 @@
+// Times record decoding for one full packet (63 records) two ways:
+//
+//   strtol + substr  the per-field parser hex.hpp replaced
+//   SWAR             hex_decode16(), what the ESP32-S3 build runs
+//
+//   g++ -std=c++20 -O2 -Isrc -o llc_hex_bench tools/llc_hex_bench.cpp
+//   ./llc_hex_bench [--iterations 200000]
+//
+// The result is host nanoseconds per packet; use it to compare the two
+// paths, not as a device figure.
+
+#include "drak/hex.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+using Clock = std::chrono::steady_clock;
+
+constexpr int RECORDS = 63;
+constexpr int RECORD_SIZE = 16;
+
+struct Decoded
+{
+    uint16_t index;
+    uint8_t r, g, b;
+    uint32_t delay;
+
+    bool operator==(const Decoded &) const = default;
+};
+
+static std::string make_packet()
+{
+    static const char digits[] = "0123456789abcdef";
+    std::string packet;
+    uint32_t x = 12345;
+
+    for (int i = 0; i < RECORDS * RECORD_SIZE; i++)
+    {
+        x = x * 1103515245 + 12345;
+        packet += digits[(x >> 16) & 0x0F];
+    }
+
+    return packet;
+}
+
+static int field(const std::string &code, size_t pos, size_t len)
+{
+    return strtol(code.substr(pos, len).c_str(), nullptr, 16);
+}
+
+static void decode_strtol(const std::string &packet, Decoded *out)
+{
+    for (int i = 0; i < RECORDS; i++)
+    {
+        const size_t p = i * RECORD_SIZE;
+        out[i] = {uint16_t(field(packet, p, 3)), uint8_t(field(packet, p + 3, 2)), uint8_t(field(packet, p + 5, 2)),
+                  uint8_t(field(packet, p + 7, 2)), uint32_t(field(packet, p + 9, 7))};
+    }
+}
+
+static void decode_nibbles(const std::string &packet, Decoded *out)
+{
+    for (int i = 0; i < RECORDS; i++)
+    {
+        uint8_t n[RECORD_SIZE];
+        hex_decode16(packet.data() + i * RECORD_SIZE, n);
+
+        out[i] = {uint16_t(n[0] << 8 | n[1] << 4 | n[2]), uint8_t(n[3] << 4 | n[4]), uint8_t(n[5] << 4 | n[6]),
+                  uint8_t(n[7] << 4 | n[8]),
+                  uint32_t(n[9]) << 24 | n[10] << 20 | n[11] << 16 | n[12] << 12 | n[13] << 8 | n[14] << 4 | n[15]};
+    }
+}
+
+template <typename Decode>
+static double time_ns(const std::string &packet, int iterations, Decode decode, uint32_t &checksum)
+{
+    Decoded out[RECORDS];
+    const auto started = Clock::now();
+
+    for (int n = 0; n < iterations; n++)
+    {
+        decode(packet, out);
+        checksum += out[n % RECORDS].delay;
+    }
+
+    return std::chrono::duration<double, std::nano>(Clock::now() - started).count() / iterations;
+}
+
+int main(int argc, char **argv)
+{
+    int iterations = 200000;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::string(argv[i]) == "--iterations" && i + 1 < argc)
+            iterations = std::atoi(argv[++i]);
+        else
+        {
+            std::fprintf(stderr, "usage: %s [--iterations N]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    const std::string packet = make_packet();
+    Decoded a[RECORDS], b[RECORDS];
+
+    decode_strtol(packet, a);
+    decode_nibbles(packet, b);
+
+    for (int i = 0; i < RECORDS; i++)
+    {
+        if (!(a[i] == b[i]))
+        {
+            std::fprintf(stderr, "decoders disagree on record %d\n", i);
+            return 1;
+        }
+    }
+
+    uint32_t checksum = 0;
+    const double baseline = time_ns(packet, iterations, decode_strtol, checksum);
+    const double swar = time_ns(packet, iterations, decode_nibbles, checksum);
+
+    std::printf("packet of %d records, %d iterations (checksum %08x)\n", RECORDS, iterations, unsigned(checksum));
+    std::printf("strtol + substr  %8.0f ns\n", baseline);
+    std::printf("SWAR             %8.0f ns  (%.1fx)\n", swar, baseline / swar);
+    return 0;
+}
@@ -0,0 +1,241 @@
+// Host-side replayer for captures dumped from GET /capture.
+//
+// Resends every captured datagram to a device (or anything else speaking the
+// protocol) at the original pacing, N times faster, or as fast as possible,
+// and reports what the receiver made of it.
+//
+//   g++ -std=c++20 -O2 -o llc_replay tools/llc_replay.cpp
+//   curl -o dump.cap http://<device>/capture
+//   ./llc_replay dump.cap <device ip> [--port 3000] [--speed N | --max] [--metrics-port 80]
+//
+// Loss and delivered fps come from scraping /metrics before and after the run;
+// latency is the round trip of acks ('a') and of discovery pings ('D') sent
+// alongside the traffic.
+
+#include "llc_tools.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <thread>
+
+using Clock = std::chrono::steady_clock;
+
+constexpr uint8_t CAPTURE_MAGIC[8] = {'L', 'L', 'C', 'A', 'P', '1', 0, 0};
+constexpr size_t CAPTURE_RECORD_HEADER_SIZE = 16;
+constexpr auto PING_INTERVAL = std::chrono::milliseconds(100);
+
+struct Datagram
+{
+    uint64_t timestamp_us;
+    std::string payload;
+};
+
+struct Options
+{
+    std::string capture;
+    std::string host;
+    uint16_t port = 3000;
+    uint16_t metrics_port = 80;
+    double speed = 1.0;
+    bool max_speed = false;
+};
+
+static std::optional<std::vector<Datagram>> read_capture(const std::string &path)
+{
+    std::ifstream in(path, std::ios::binary);
+    std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+    if (bytes.size() < sizeof(CAPTURE_MAGIC) || std::memcmp(bytes.data(), CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC)) != 0)
+        return std::nullopt;
+
+    std::vector<Datagram> out;
+    size_t pos = sizeof(CAPTURE_MAGIC);
+
+    while (pos + CAPTURE_RECORD_HEADER_SIZE <= bytes.size())
+    {
+        const uint8_t *h = bytes.data() + pos;
+        const size_t len = load_le(h + 14, 2);
+
+        if (pos + CAPTURE_RECORD_HEADER_SIZE + len > bytes.size())
+            break;
+
+        out.push_back({load_le(h, 8), std::string(reinterpret_cast<const char *>(h + CAPTURE_RECORD_HEADER_SIZE), len)});
+        pos += CAPTURE_RECORD_HEADER_SIZE + len;
+    }
+
+    return out;
+}
+
+static bool parse_args(int argc, char **argv, Options &o)
+{
+    int positional = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string arg = argv[i];
+
+        if (arg == "--port" && i + 1 < argc)
+            o.port = std::atoi(argv[++i]);
+        else if (arg == "--metrics-port" && i + 1 < argc)
+            o.metrics_port = std::atoi(argv[++i]);
+        else if (arg == "--speed" && i + 1 < argc)
+            o.speed = std::atof(argv[++i]);
+        else if (arg == "--max")
+            o.max_speed = true;
+        else if (positional == 0 && ++positional)
+            o.capture = arg;
+        else if (positional == 1 && ++positional)
+            o.host = arg;
+        else
+            return false;
+    }
+
+    return positional == 2 && o.speed > 0;
+}
+
+int main(int argc, char **argv)
+{
+    Options opt;
+
+    if (!parse_args(argc, argv, opt))
+    {
+        std::fprintf(stderr, "usage: %s <capture> <host> [--port P] [--speed N | --max] [--metrics-port P]\n", argv[0]);
+        return 2;
+    }
+
+    const auto capture = read_capture(opt.capture);
+
+    if (!capture || capture->empty())
+    {
+        std::fprintf(stderr, "%s: not a capture or empty\n", opt.capture.c_str());
+        return 1;
+    }
+
+    const int sock = socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in dest{};
+    dest.sin_family = AF_INET;
+    dest.sin_port = htons(opt.port);
+
+    if (inet_pton(AF_INET, opt.host.c_str(), &dest.sin_addr) != 1)
+    {
+        std::fprintf(stderr, "%s: invalid ipv4 address\n", opt.host.c_str());
+        return 1;
+    }
+
+    timeval tv{0, 1000};
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    auto before = scrape_metrics(opt.host, opt.metrics_port);
+
+    // Outstanding requests keyed by the header the device echoes back.
+    std::map<std::string, Clock::time_point> pending;
+    std::vector<double> rtt_ms;
+    int status_count = 0;
+    double last_status_fps = 0;
+
+    auto poll_replies = [&]()
+    {
+        char buf[64];
+        ssize_t n;
+
+        while ((n = recv(sock, buf, sizeof(buf), MSG_DONTWAIT)) > 0)
+        {
+            std::string key;
+
+            if (buf[0] == 'a' && n > 2)
+                key.assign(buf + 2, n - 2);
+            else if (buf[0] == 'd')
+                key = "D";
+            else if (buf[0] == 's' && n >= 6)
+            {
+                status_count++;
+                last_status_fps = load_le(reinterpret_cast<uint8_t *>(buf) + 4, 2) / 10.0;
+                continue;
+            }
+
+            const auto it = pending.find(key);
+            if (it != pending.end())
+            {
+                rtt_ms.push_back(std::chrono::duration<double, std::milli>(Clock::now() - it->second).count());
+                pending.erase(it);
+            }
+        }
+    };
+
+    auto send_datagram = [&](const std::string &payload)
+    {
+        sendto(sock, payload.data(), payload.size(), 0, reinterpret_cast<sockaddr *>(&dest), sizeof(dest));
+    };
+
+    const auto started = Clock::now();
+    auto next_ping = started;
+    const uint64_t first_us = capture->front().timestamp_us;
+
+    for (const auto &d : *capture)
+    {
+        if (!opt.max_speed)
+        {
+            const auto due = started + std::chrono::microseconds(uint64_t((d.timestamp_us - first_us) / opt.speed));
+
+            while (Clock::now() < due)
+            {
+                poll_replies();
+                std::this_thread::sleep_until(std::min(due, Clock::now() + std::chrono::milliseconds(1)));
+            }
+        }
+
+        const char tag = d.payload.empty() ? 0 : d.payload[0];
+        const size_t head = tag == 'C' ? 5 : tag == 'U' ? 6 : tag == 'P' ? 2 : 0;
+
+        if (head > 0 && d.payload.size() >= head)
+            pending[d.payload.substr(0, head)] = Clock::now();
+
+        send_datagram(d.payload);
+
+        if (Clock::now() >= next_ping && pending.find("D") == pending.end())
+        {
+            pending["D"] = Clock::now();
+            send_datagram("D");
+            next_ping = Clock::now() + PING_INTERVAL;
+        }
+
+        poll_replies();
+    }
+
+    const double elapsed = std::chrono::duration<double>(Clock::now() - started).count();
+
+    // Let the last acks and one more advertisement arrive.
+    for (auto until = Clock::now() + std::chrono::milliseconds(1200); Clock::now() < until;)
+        poll_replies();
+
+    auto after = scrape_metrics(opt.host, opt.metrics_port);
+    const size_t sent = capture->size();
+
+    std::printf("sent       %zu datagrams in %.2f s (%.1f/s)\n", sent, elapsed, sent / elapsed);
+
+    if (before && after)
+    {
+        auto delta = [&](const char *name) { return (*after)[name] - (*before)[name]; };
+        const double received = delta("llc_packets_received_total");
+        const double lost = sent > received ? sent - received : 0;
+
+        std::printf("received   %.0f (loss %.2f%%), dropped in queue %.0f\n", received, 100.0 * lost / sent,
+                    delta("llc_packets_dropped_total"));
+        std::printf("delivered  %.1f fps\n", delta("llc_frames_rendered_total") / elapsed);
+    }
+    else if (status_count > 0)
+    {
+        std::printf("delivered  %.1f fps (last status advertisement; /metrics unreachable)\n", last_status_fps);
+    }
+    else
+    {
+        std::printf("delivered  unknown (/metrics unreachable, no status advertisement)\n");
+    }
+
+    std::printf("round trip %zu samples, p50 %.2f ms, p90 %.2f ms, p99 %.2f ms\n", rtt_ms.size(),
+                percentile(rtt_ms, 0.5), percentile(rtt_ms, 0.9), percentile(rtt_ms, 0.99));
+
+    close(sock);
+    return 0;
+}
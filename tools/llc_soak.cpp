@@ -0,0 +1,391 @@
+// Long-running traffic generator for soaking a device end to end.
+//
+// Streams random fragmented frames over UDP at a fixed rate and packet size
+// for as long as asked, then sends one known frame and reads it back from
+// GET /frame to check that what reached the strip is exactly what was sent.
+//
+//   g++ -std=c++20 -O2 -o llc_soak tools/llc_soak.cpp
+//   ./llc_soak <device ip> [--port 3000] [--metrics-port 80] [--rate 60] [--records 20]
+//              [--leds N] [--duration 3600] [--report 10] [--seed 1]
+//
+// --records is the number of pixels per fragment, so it sets the packet size
+// (9 + 16 * records bytes). Every frame ends with a commit; the time from its
+// first fragment to the commit's ack is the per-frame latency. Throughput and
+// heap come from /metrics, scraped every --report seconds.
+
+#include "llc_tools.hpp"
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <random>
+#include <thread>
+
+using Clock = std::chrono::steady_clock;
+
+constexpr int RECORD_SIZE = 16;
+constexpr int MAX_FRAGMENTS = 64;
+constexpr char ACK = 'a';
+constexpr uint8_t ACK_JOB = 2;
+constexpr uint8_t ACK_DROPPED = 3;
+
+// A frame still unacked after this long, or this many frames later, is given
+// up on. The frame limit keeps ids from being matched again after they wrap.
+constexpr auto ACK_TIMEOUT = std::chrono::seconds(2);
+constexpr uint16_t ACK_WINDOW = 1024;
+
+struct Options
+{
+    std::string host;
+    uint16_t port = 3000;
+    uint16_t metrics_port = 80;
+    double rate = 60;
+    int records = 20;
+    int leds = 0;
+    double duration = 3600;
+    double report = 10;
+    unsigned seed = 1;
+};
+
+struct Stats
+{
+    uint64_t frames_sent = 0;
+    uint64_t packets_sent = 0;
+    uint64_t acked_job = 0;
+    uint64_t acked_dropped = 0;
+    uint64_t acked_rejected = 0;
+    uint64_t expired = 0;
+    std::vector<double> latency_ms;
+};
+
+class Soak
+{
+private:
+    const Options &opt;
+    int sock;
+    sockaddr_in dest{};
+    std::mt19937 rng;
+
+    uint16_t frame_id = 0;
+    std::map<uint16_t, Clock::time_point> pending;
+
+    // How many frames ago `id` was sent, across the 16-bit wrap.
+    uint16_t age(uint16_t id) const { return uint16_t(frame_id - 1 - id); }
+
+    void expire_pending()
+    {
+        const auto now = Clock::now();
+
+        for (auto it = pending.begin(); it != pending.end();)
+        {
+            if (now - it->second > ACK_TIMEOUT || age(it->first) >= ACK_WINDOW)
+            {
+                it = pending.erase(it);
+                stats.expired++;
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    }
+
+    void send_datagram(const std::string &payload)
+    {
+        sendto(sock, payload.data(), payload.size(), 0, reinterpret_cast<sockaddr *>(&dest), sizeof(dest));
+    }
+
+    static void put_hex(std::string &out, uint32_t v, int digits)
+    {
+        static const char *hex = "0123456789abcdef";
+        for (int i = digits - 1; i >= 0; i--)
+            out += hex[(v >> (i * 4)) & 0xF];
+    }
+
+public:
+    Stats stats;
+
+    Soak(const Options &o, int s, const sockaddr_in &d) : opt(o), sock(s), dest(d), rng(o.seed) {}
+
+    // Fragments declare the maximum count, so every frame is presented by its
+    // commit and each one produces exactly one ack.
+    uint16_t send_frame(const std::vector<uint8_t> &rgb)
+    {
+        const uint16_t id = frame_id++;
+        const int leds = rgb.size() / 3;
+
+        pending[id] = Clock::now();
+
+        for (int first = 0, index = 0; first < leds; first += opt.records, index++)
+        {
+            std::string p = "F";
+            put_hex(p, id, 4);
+            put_hex(p, index, 2);
+            put_hex(p, MAX_FRAGMENTS, 2);
+
+            for (int i = first; i < std::min(leds, first + opt.records); i++)
+            {
+                put_hex(p, i, 3);
+                put_hex(p, rgb[i * 3 + 0], 2);
+                put_hex(p, rgb[i * 3 + 1], 2);
+                put_hex(p, rgb[i * 3 + 2], 2);
+                put_hex(p, 0, 7);
+            }
+
+            send_datagram(p);
+            stats.packets_sent++;
+        }
+
+        std::string commit = "C";
+        put_hex(commit, id, 4);
+        send_datagram(commit);
+        stats.packets_sent++;
+        stats.frames_sent++;
+
+        return id;
+    }
+
+    std::vector<uint8_t> random_frame()
+    {
+        std::vector<uint8_t> rgb(opt.leds * 3);
+        for (auto &c : rgb)
+            c = rng();
+        return rgb;
+    }
+
+    // Drains acks; returns the result of `wanted` if its ack was among them.
+    std::optional<uint8_t> poll_acks(std::optional<uint16_t> wanted = std::nullopt)
+    {
+        std::optional<uint8_t> found;
+        uint8_t buf[64];
+        ssize_t n;
+
+        while ((n = recv(sock, buf, sizeof(buf), MSG_DONTWAIT)) > 0)
+        {
+            if (buf[0] != ACK || n < 7 || buf[2] != 'C')
+                continue;
+
+            uint16_t id = 0;
+            for (int i = 3; i < 7; i++)
+                id = id << 4 | (buf[i] <= '9' ? buf[i] - '0' : (buf[i] | 0x20) - 'a' + 10);
+
+            if (age(id) >= ACK_WINDOW)
+                continue;
+
+            const auto it = pending.find(id);
+            if (it == pending.end())
+                continue;
+
+            stats.latency_ms.push_back(std::chrono::duration<double, std::milli>(Clock::now() - it->second).count());
+            pending.erase(it);
+
+            if (buf[1] == ACK_JOB)
+                stats.acked_job++;
+            else if (buf[1] == ACK_DROPPED)
+                stats.acked_dropped++;
+            else
+                stats.acked_rejected++;
+
+            if (wanted && *wanted == id)
+                found = buf[1];
+        }
+
+        expire_pending();
+        return found;
+    }
+
+    // Learns the strip length from a discovery reply.
+    int discover_leds()
+    {
+        for (int attempt = 0; attempt < 10; attempt++)
+        {
+            send_datagram("D");
+
+            for (auto until = Clock::now() + std::chrono::milliseconds(200); Clock::now() < until;)
+            {
+                uint8_t buf[64];
+                if (recv(sock, buf, sizeof(buf), 0) >= 6 && buf[0] == 'd')
+                    return load_le(buf + 2, 2);
+            }
+        }
+
+        return 0;
+    }
+};
+
+static bool parse_args(int argc, char **argv, Options &o)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string arg = argv[i];
+        const bool has_value = i + 1 < argc;
+
+        if (arg == "--port" && has_value)
+            o.port = std::atoi(argv[++i]);
+        else if (arg == "--metrics-port" && has_value)
+            o.metrics_port = std::atoi(argv[++i]);
+        else if (arg == "--rate" && has_value)
+            o.rate = std::atof(argv[++i]);
+        else if (arg == "--records" && has_value)
+            o.records = std::atoi(argv[++i]);
+        else if (arg == "--leds" && has_value)
+            o.leds = std::atoi(argv[++i]);
+        else if (arg == "--duration" && has_value)
+            o.duration = std::atof(argv[++i]);
+        else if (arg == "--report" && has_value)
+            o.report = std::atof(argv[++i]);
+        else if (arg == "--seed" && has_value)
+            o.seed = std::atoi(argv[++i]);
+        else if (o.host.empty())
+            o.host = arg;
+        else
+            return false;
+    }
+
+    return !o.host.empty() && o.rate > 0 && o.records > 0 && o.report > 0;
+}
+
+static void report(const Stats &s, double elapsed, std::map<std::string, double> start,
+                   std::map<std::string, double> now)
+{
+    auto delta = [&](const char *name) { return now[name] - start[name]; };
+
+    std::printf("%8.0fs  sent %.0f pkt/s  received %.0f pkt/s  rendered %.1f fps  "
+                "latency p50 %.2f p99 %.2f ms  free heap %+.0f B (min %.0f)\n",
+                elapsed, s.packets_sent / elapsed, delta("llc_packets_received_total") / elapsed,
+                delta("llc_frames_rendered_total") / elapsed, percentile(s.latency_ms, 0.5),
+                percentile(s.latency_ms, 0.99), delta("llc_heap_free_bytes"), now["llc_heap_min_free_bytes"]);
+    std::fflush(stdout);
+}
+
+int main(int argc, char **argv)
+{
+    Options opt;
+
+    if (!parse_args(argc, argv, opt))
+    {
+        std::fprintf(stderr,
+                     "usage: %s <host> [--port P] [--metrics-port P] [--rate fps] [--records N] [--leds N] "
+                     "[--duration s] [--report s] [--seed N]\n",
+                     argv[0]);
+        return 2;
+    }
+
+    const int sock = socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in dest{};
+    dest.sin_family = AF_INET;
+    dest.sin_port = htons(opt.port);
+
+    if (inet_pton(AF_INET, opt.host.c_str(), &dest.sin_addr) != 1)
+    {
+        std::fprintf(stderr, "%s: invalid ipv4 address\n", opt.host.c_str());
+        return 1;
+    }
+
+    timeval tv{0, 10 * 1000};
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    Soak soak(opt, sock, dest);
+
+    if (opt.leds == 0 && (opt.leds = soak.discover_leds()) == 0)
+    {
+        std::fprintf(stderr, "%s: no discovery reply, pass --leds\n", opt.host.c_str());
+        return 1;
+    }
+
+    if ((opt.leds + opt.records - 1) / opt.records > MAX_FRAGMENTS - 1)
+    {
+        std::fprintf(stderr, "%d leds need more than %d fragments of %d records\n", opt.leds, MAX_FRAGMENTS - 1,
+                     opt.records);
+        return 1;
+    }
+
+    const auto start_metrics = scrape_metrics(opt.host, opt.metrics_port);
+
+    if (!start_metrics)
+        std::fprintf(stderr, "warning: /metrics unreachable, only sender-side numbers will be reported\n");
+
+    std::printf("soaking %s: %d leds, %d records per fragment (%d bytes), %.1f fps for %.0f s\n", opt.host.c_str(),
+                opt.leds, opt.records, 9 + RECORD_SIZE * opt.records, opt.rate, opt.duration);
+
+    const auto period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / opt.rate));
+    const auto started = Clock::now();
+    auto next_frame = started;
+    auto next_report = started + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(opt.report));
+
+    while (std::chrono::duration<double>(Clock::now() - started).count() < opt.duration)
+    {
+        soak.send_frame(soak.random_frame());
+        next_frame += period;
+
+        while (Clock::now() < next_frame)
+        {
+            soak.poll_acks();
+            std::this_thread::sleep_until(std::min(next_frame, Clock::now() + std::chrono::milliseconds(1)));
+        }
+
+        if (Clock::now() >= next_report)
+        {
+            const double elapsed = std::chrono::duration<double>(Clock::now() - started).count();
+            const auto now = scrape_metrics(opt.host, opt.metrics_port);
+
+            if (start_metrics && now)
+                report(soak.stats, elapsed, *start_metrics, *now);
+
+            next_report += std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(opt.report));
+        }
+    }
+
+    // Final frame: retried until the device queues it, then read back.
+    const auto expected = soak.random_frame();
+    bool queued = false;
+
+    for (int attempt = 0; attempt < 20 && !queued; attempt++)
+    {
+        const uint16_t id = soak.send_frame(expected);
+
+        for (auto until = Clock::now() + std::chrono::milliseconds(100); Clock::now() < until && !queued;)
+            queued = soak.poll_acks(id) == ACK_JOB;
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    soak.poll_acks();
+
+    const Stats &s = soak.stats;
+    const double elapsed = std::chrono::duration<double>(Clock::now() - started).count();
+    const uint64_t unacked = s.frames_sent - s.acked_job - s.acked_dropped - s.acked_rejected;
+
+    std::printf("frames     %" PRIu64 " sent, %" PRIu64 " queued, %" PRIu64 " dropped by the pipeline, %" PRIu64
+                " rejected, %" PRIu64 " unacked (%" PRIu64 " given up after %lld s)\n",
+                s.frames_sent, s.acked_job, s.acked_dropped, s.acked_rejected, unacked, s.expired,
+                static_cast<long long>(ACK_TIMEOUT.count()));
+    std::printf("latency    %zu samples, p50 %.2f ms, p90 %.2f ms, p99 %.2f ms, max %.2f ms\n", s.latency_ms.size(),
+                percentile(s.latency_ms, 0.5), percentile(s.latency_ms, 0.9), percentile(s.latency_ms, 0.99),
+                percentile(s.latency_ms, 1.0));
+
+    if (auto now = scrape_metrics(opt.host, opt.metrics_port); start_metrics && now)
+        report(s, elapsed, *start_metrics, *now);
+
+    const auto frame = http_get(opt.host, opt.metrics_port, "/frame");
+    int mismatched = 0;
+
+    if (!queued || !frame || frame->size() < size_t(opt.leds) * 6)
+    {
+        std::printf("final      could not verify (%s)\n", queued ? "GET /frame failed" : "final frame never queued");
+        return 1;
+    }
+
+    for (int i = 0; i < opt.leds; i++)
+    {
+        char want[7];
+        std::snprintf(want, sizeof(want), "%02x%02x%02x", expected[i * 3], expected[i * 3 + 1], expected[i * 3 + 2]);
+
+        if (frame->compare(i * 6, 6, want) != 0)
+            mismatched++;
+    }
+
+    std::printf("final      %s (%d of %d leds differ)\n", mismatched == 0 ? "OK" : "MISMATCH", mismatched, opt.leds);
+    close(sock);
+    return mismatched == 0 ? 0 : 1;
+}
@@ -0,0 +1,178 @@
+// Measures how closely a group of controllers latch a frame together.
+//
+// Puts every device in staged mode, keeps their clocks disciplined with 'T'
+// beacons, and repeatedly sends a frame followed by a latch scheduled --lead
+// ms ahead. After each latch it reads from every device which beacon last
+// arrived before the latch (llc_sync_latch_beacon_us) and how long after that
+// beacon, on the device's own clock, the latch went out
+// (llc_sync_latch_since_beacon_us). When every device names the same beacon,
+// the spread of the second value is the skew. It does not go through any
+// device's clock estimate, so offset errors show up in it.
+//
+//   g++ -std=c++20 -O2 -o llc_sync tools/llc_sync.cpp
+//   ./llc_sync <device ip>... [--port 3000] [--metrics-port 80] [--latches 100] [--lead 50]
+//
+// Beacons are sent to each device in turn, so the figure also holds the gap
+// between those sends and any difference in their delivery; only a light
+// sensor on the strips sees the true skew. llc_sync_offset_spread_us bounds
+// the delivery jitter per device.
+
+#include "llc_tools.hpp"
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
+using Clock = std::chrono::steady_clock;
+
+constexpr auto BEACON_INTERVAL = std::chrono::milliseconds(50);
+
+struct Options
+{
+    std::vector<std::string> hosts;
+    uint16_t port = 3000;
+    uint16_t metrics_port = 80;
+    int latches = 100;
+    int lead_ms = 50;
+};
+
+static int64_t now_us()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now().time_since_epoch()).count();
+}
+
+static std::string with_time(char tag, int64_t us)
+{
+    std::string msg(1, tag);
+    for (int i = 0; i < 8; i++)
+        msg += char(uint64_t(us) >> (i * 8));
+    return msg;
+}
+
+static bool parse_args(int argc, char **argv, Options &o)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string arg = argv[i];
+        const bool has_value = i + 1 < argc;
+
+        if (arg == "--port" && has_value)
+            o.port = std::atoi(argv[++i]);
+        else if (arg == "--metrics-port" && has_value)
+            o.metrics_port = std::atoi(argv[++i]);
+        else if (arg == "--latches" && has_value)
+            o.latches = std::atoi(argv[++i]);
+        else if (arg == "--lead" && has_value)
+            o.lead_ms = std::atoi(argv[++i]);
+        else
+            o.hosts.push_back(arg);
+    }
+
+    return !o.hosts.empty() && o.latches > 0 && o.lead_ms > 0;
+}
+
+int main(int argc, char **argv)
+{
+    Options opt;
+
+    if (!parse_args(argc, argv, opt))
+    {
+        std::fprintf(stderr, "usage: %s <device ip>... [--port P] [--metrics-port P] [--latches N] [--lead ms]\n",
+                     argv[0]);
+        return 2;
+    }
+
+    const int sock = socket(AF_INET, SOCK_DGRAM, 0);
+    std::vector<sockaddr_in> devices;
+
+    for (const auto &host : opt.hosts)
+    {
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(opt.port);
+
+        if (inet_pton(AF_INET, host.c_str(), &addr.sin_addr) != 1)
+        {
+            std::fprintf(stderr, "%s: invalid ipv4 address\n", host.c_str());
+            return 1;
+        }
+        devices.push_back(addr);
+    }
+
+    auto send_all = [&](const std::string &msg)
+    {
+        for (const auto &d : devices)
+            sendto(sock, msg.data(), msg.size(), 0, reinterpret_cast<const sockaddr *>(&d), sizeof(d));
+    };
+
+    // Beacons keep flowing while waiting, so clocks never go stale.
+    int64_t last_beacon = 0;
+
+    auto beacon_for = [&](std::chrono::milliseconds duration)
+    {
+        for (auto until = Clock::now() + duration; Clock::now() < until;)
+        {
+            last_beacon = now_us();
+            send_all(with_time('T', last_beacon));
+            std::this_thread::sleep_for(std::min<Clock::duration>(BEACON_INTERVAL, until - Clock::now()));
+        }
+    };
+
+    send_all(std::string("S\x01", 2));
+    beacon_for(std::chrono::milliseconds(1000));
+
+    std::vector<double> skew_us;
+
+    for (int n = 0; n < opt.latches; n++)
+    {
+        char frame_id[5];
+        std::snprintf(frame_id, sizeof(frame_id), "%04x", n & 0xFFFF);
+
+        std::string fragment = std::string("F") + frame_id + "0040";
+        for (int i = 0; i < 8; i++)
+        {
+            char record[17];
+            std::snprintf(record, sizeof(record), "%03x%02x%02x%02x0000000", i, (n * 37) & 0xFF, 0, 0);
+            fragment += record;
+        }
+
+        send_all(fragment);
+        send_all(std::string("C") + frame_id);
+
+        const int64_t reference = last_beacon;
+        const int64_t latch_at = now_us() + opt.lead_ms * 1000;
+        send_all(with_time('Y', latch_at));
+        beacon_for(std::chrono::milliseconds(opt.lead_ms + 30));
+
+        int64_t lo = INT64_MAX, hi = INT64_MIN;
+        size_t answered = 0;
+
+        for (const auto &host : opt.hosts)
+        {
+            auto m = scrape_metrics(host, opt.metrics_port);
+            if (!m)
+                continue;
+
+            // A device that missed the reference beacon, or this latch, has
+            // nothing comparable to report.
+            if (int64_t((*m)["llc_sync_latch_beacon_us"]) != reference)
+                continue;
+
+            const int64_t t = (*m)["llc_sync_latch_since_beacon_us"];
+            lo = std::min(lo, t);
+            hi = std::max(hi, t);
+            answered++;
+        }
+
+        if (answered == devices.size())
+            skew_us.push_back(hi - lo);
+    }
+
+    send_all(std::string("S\x00", 2));
+
+    std::printf("latches    %zu of %d seen by all %zu devices\n", skew_us.size(), opt.latches, devices.size());
+    std::printf("skew       p50 %.0f us, p90 %.0f us, p99 %.0f us, max %.0f us\n", percentile(skew_us, 0.5),
+                percentile(skew_us, 0.9), percentile(skew_us, 0.99), percentile(skew_us, 1.0));
+
+    close(sock);
+    return 0;
+}
@@ -0,0 +1,100 @@
+// Helpers shared by the host tools in this directory. POSIX only.
+
+#ifndef LLC_TOOLS_HPP
+#define LLC_TOOLS_HPP
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cstdint>
+#include <cstdlib>
+#include <map>
+#include <netinet/in.h>
+#include <optional>
+#include <string>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+inline uint64_t load_le(const uint8_t *p, int n)
+{
+    uint64_t v = 0;
+    for (int i = n - 1; i >= 0; i--)
+        v = (v << 8) | p[i];
+    return v;
+}
+
+inline double percentile(std::vector<double> v, double q)
+{
+    if (v.empty())
+        return 0;
+
+    std::sort(v.begin(), v.end());
+    return v[std::min(v.size() - 1, size_t(q * v.size()))];
+}
+
+// Body of a plain HTTP/1.0 GET, or nothing if the server cannot be reached.
+inline std::optional<std::string> http_get(const std::string &host, uint16_t port, const std::string &path)
+{
+    const int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    inet_pton(AF_INET, host.c_str(), &addr.sin_addr);
+
+    timeval tv{2, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    if (connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0)
+    {
+        close(fd);
+        return std::nullopt;
+    }
+
+    const std::string req = "GET " + path + " HTTP/1.0\r\nHost: " + host + "\r\n\r\n";
+    send(fd, req.data(), req.size(), 0);
+
+    std::string response;
+    char buf[1024];
+    for (ssize_t n; (n = recv(fd, buf, sizeof(buf), 0)) > 0;)
+        response.append(buf, n);
+    close(fd);
+
+    const size_t body = response.find("\r\n\r\n");
+    if (body == std::string::npos)
+        return std::nullopt;
+
+    return response.substr(body + 4);
+}
+
+// Scrapes /metrics and sums the samples of every family over its labels,
+// e.g. the per-core llc_packets_received_total series.
+inline std::optional<std::map<std::string, double>> scrape_metrics(const std::string &host, uint16_t port)
+{
+    const auto body = http_get(host, port, "/metrics");
+    if (!body)
+        return std::nullopt;
+
+    std::map<std::string, double> families;
+    size_t start = 0;
+
+    while (start < body->size())
+    {
+        size_t end = body->find('\n', start);
+        if (end == std::string::npos)
+            end = body->size();
+
+        const std::string line = body->substr(start, end - start);
+        const size_t space = line.rfind(' ');
+        start = end + 1;
+
+        if (line.empty() || line[0] == '#' || space == std::string::npos)
+            continue;
+
+        const std::string name = line.substr(0, std::min(line.find('{'), space));
+        families[name] += std::atof(line.c_str() + space + 1);
+    }
+
+    return families;
+}
+
+#endif // LLC_TOOLS_HPP